@@ -0,0 +1,306 @@
+#ifndef CPPSTDDB_ARROW_H
+#define CPPSTDDB_ARROW_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+   Columnar result batches (see rowset::fetch_batch) and their export
+   through the Arrow C data interface, so that consumers can take the
+   buffers without copying them:
+   https://arrow.apache.org/docs/format/CDataInterface.html
+ */
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+
+    struct ArrowSchema {
+        // Array type description
+        const char* format;
+        const char* name;
+        const char* metadata;
+        int64_t flags;
+        int64_t n_children;
+        struct ArrowSchema** children;
+        struct ArrowSchema* dictionary;
+
+        // Release callback
+        void (*release)(struct ArrowSchema*);
+        // Opaque producer-specific data
+        void* private_data;
+    };
+
+    struct ArrowArray {
+        // Array data description
+        int64_t length;
+        int64_t null_count;
+        int64_t offset;
+        int64_t n_buffers;
+        int64_t n_children;
+        const void** buffers;
+        struct ArrowArray** children;
+        struct ArrowArray* dictionary;
+
+        // Release callback
+        void (*release)(struct ArrowArray*);
+        // Opaque producer-specific data
+        void* private_data;
+    };
+
+}
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+namespace cppstddb {
+
+    enum class column_type {
+        int32,   // arrow "i"
+        utf8,    // arrow "u"
+        date32,  // arrow "tdD", days since 1970-01-01
+        int64,   // arrow "l"
+        float64, // arrow "g"
+        binary,  // arrow "z"
+    };
+
+    class column_buffer {
+        public:
+            using string = std::string;
+
+            column_buffer(const string& name, column_type type):
+                name_(name),
+                type_(type),
+                length_(0),
+                null_count_(0) {
+                    if (variable()) offsets_.push_back(0);
+                }
+
+            const string& name() const {return name_;}
+            column_type type() const {return type_;}
+            int64_t length() const {return length_;}
+            int64_t null_count() const {return null_count_;}
+
+            const std::vector<uint8_t>& validity() const {return validity_;}
+            const std::vector<int32_t>& values() const {return values_;}   // int32, date32
+            const std::vector<int64_t>& values64() const {return values64_;} // int64
+            const std::vector<double>& reals() const {return reals_;}     // float64
+            const std::vector<int32_t>& offsets() const {return offsets_;} // utf8, binary
+            const std::vector<char>& data() const {return data_;}          // utf8, binary
+
+            // offsets and data rather than one fixed width value buffer
+            bool variable() const {return type_ == column_type::utf8 || type_ == column_type::binary;}
+
+            bool is_valid(int64_t i) const {return (validity_[i >> 3] >> (i & 7)) & 1;}
+
+            // the fixed width value buffer (for export)
+            const void* value_buffer() const {
+                switch(type_) {
+                    case column_type::int64: return values64_.data();
+                    case column_type::float64: return reals_.data();
+                    default: return values_.data();
+                }
+            }
+
+            void reserve(size_t n) {
+                validity_.reserve((n + 7) / 8);
+                switch(type_) {
+                    case column_type::int64: values64_.reserve(n); break;
+                    case column_type::float64: reals_.reserve(n); break;
+                    default: if (variable()) offsets_.reserve(n + 1); else values_.reserve(n);
+                }
+            }
+
+            void append(int32_t v) {
+                values_.push_back(v);
+                set_valid(true);
+            }
+
+            void append(int64_t v) {
+                values64_.push_back(v);
+                set_valid(true);
+            }
+
+            void append(double v) {
+                reals_.push_back(v);
+                set_valid(true);
+            }
+
+            void append(const char* s, size_t n) {
+                data_.insert(data_.end(), s, s + n);
+                offsets_.push_back(static_cast<int32_t>(data_.size()));
+                set_valid(true);
+            }
+
+            void append_null() {
+                switch(type_) {
+                    case column_type::int64: values64_.push_back(0); break;
+                    case column_type::float64: reals_.push_back(0); break;
+                    default: if (variable()) offsets_.push_back(offsets_.back()); else values_.push_back(0);
+                }
+                ++null_count_;
+                set_valid(false);
+            }
+
+            // arrow format string
+            const char* format() const {
+                switch(type_) {
+                    case column_type::int32: return "i";
+                    case column_type::utf8: return "u";
+                    case column_type::date32: return "tdD";
+                    case column_type::int64: return "l";
+                    case column_type::float64: return "g";
+                    case column_type::binary: return "z";
+                }
+                return "";
+            }
+
+        private:
+            string name_;
+            column_type type_;
+            int64_t length_;
+            int64_t null_count_;
+            std::vector<uint8_t> validity_;
+            std::vector<int32_t> values_;
+            std::vector<int64_t> values64_;
+            std::vector<double> reals_;
+            std::vector<int32_t> offsets_;
+            std::vector<char> data_;
+
+            void set_valid(bool valid) {
+                if ((length_ & 7) == 0) validity_.push_back(0);
+                if (valid) validity_.back() |= static_cast<uint8_t>(1 << (length_ & 7));
+                ++length_;
+            }
+    };
+
+    class column_batch {
+        public:
+            using string = std::string;
+
+            column_batch() {}
+
+            size_t width() const {return columns_.size();}
+            int64_t length() const {return columns_.empty() ? 0 : columns_[0].length();}
+            bool empty() const {return length() == 0;}
+
+            column_buffer& operator[](size_t i) {return columns_[i];}
+            const column_buffer& operator[](size_t i) const {return columns_[i];}
+
+            column_buffer& add_column(const string& name, column_type type) {
+                columns_.emplace_back(name, type);
+                return columns_.back();
+            }
+
+            // move the batch into a struct array; the batch is left empty
+            void export_to(ArrowArray* array, ArrowSchema* schema);
+
+        private:
+            std::vector<column_buffer> columns_;
+    };
+
+    namespace arrow_impl {
+
+        struct schema_data {
+            std::string name;
+            std::vector<ArrowSchema> children;
+            std::vector<ArrowSchema*> child_ptrs;
+        };
+
+        struct array_data {
+            std::vector<column_buffer> columns; // owns the buffers
+            std::vector<const void*> buffers;
+            std::vector<ArrowArray> children;
+            std::vector<ArrowArray*> child_ptrs;
+        };
+
+        inline void release_schema(ArrowSchema* schema) {
+            auto data = static_cast<schema_data*>(schema->private_data);
+            if (data) {
+                for(auto& c : data->children) if (c.release) c.release(&c);
+                delete data;
+            }
+            schema->release = nullptr;
+        }
+
+        inline void release_array(ArrowArray* array) {
+            auto data = static_cast<array_data*>(array->private_data);
+            if (data) {
+                for(auto& c : data->children) if (c.release) c.release(&c);
+                delete data;
+            }
+            array->release = nullptr;
+        }
+
+        inline void init_schema(ArrowSchema* schema, const char* format, schema_data* data, int64_t flags) {
+            schema->format = format;
+            schema->name = data->name.c_str();
+            schema->metadata = nullptr;
+            schema->flags = flags;
+            schema->n_children = data->children.size();
+            schema->children = data->child_ptrs.empty() ? nullptr : &data->child_ptrs[0];
+            schema->dictionary = nullptr;
+            schema->release = release_schema;
+            schema->private_data = data;
+        }
+
+        inline void init_array(ArrowArray* array, int64_t length, int64_t null_count, array_data* data) {
+            array->length = length;
+            array->null_count = null_count;
+            array->offset = 0;
+            array->n_buffers = data->buffers.size();
+            array->n_children = data->children.size();
+            array->buffers = data->buffers.empty() ? nullptr : &data->buffers[0];
+            array->children = data->child_ptrs.empty() ? nullptr : &data->child_ptrs[0];
+            array->dictionary = nullptr;
+            array->release = release_array;
+            array->private_data = data;
+        }
+
+    }
+
+    inline void column_batch::export_to(ArrowArray* array, ArrowSchema* schema) {
+        using namespace arrow_impl;
+        auto n = columns_.size();
+        auto length = this->length();
+
+        auto sdata = new schema_data();
+        sdata->children.resize(n);
+        for(size_t i = 0; i != n; ++i) {
+            auto child = new schema_data();
+            child->name = columns_[i].name();
+            init_schema(&sdata->children[i], columns_[i].format(), child, ARROW_FLAG_NULLABLE);
+            sdata->child_ptrs.push_back(&sdata->children[i]);
+        }
+        init_schema(schema, "+s", sdata, 0);
+
+        auto adata = new array_data();
+        adata->buffers.push_back(nullptr); // struct level validity: none
+        adata->children.resize(n);
+        for(size_t i = 0; i != n; ++i) {
+            auto child = new array_data();
+            child->columns.push_back(std::move(columns_[i]));
+            auto& c = child->columns.back();
+            child->buffers.push_back(c.null_count() ? c.validity().data() : nullptr);
+            if (c.variable()) {
+                child->buffers.push_back(c.offsets().data());
+                child->buffers.push_back(c.data().data());
+            } else {
+                child->buffers.push_back(c.value_buffer());
+            }
+            init_array(&adata->children[i], c.length(), c.null_count(), child);
+            adata->child_ptrs.push_back(&adata->children[i]);
+        }
+        init_array(array, length, 0, adata);
+
+        columns_.clear();
+    }
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef CPPSTDDB_ASYNC_H
+#define CPPSTDDB_ASYNC_H
+
+#include <future>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <exception>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define CPPSTDDB_COROUTINES 1
+#endif
+#endif
+
+/*
+   Result of an asynchronous operation (see statement::async_query). It can
+   be waited on as a future or, when compiled as C++20, co_awaited. The
+   completion (and so the coroutine resumption) runs on the thread that
+   finished the operation, typically a reactor thread.
+ */
+
+namespace cppstddb {
+
+    template<class T> class async_result {
+        public:
+            using value_type = T;
+            using future_type = std::shared_future<value_type>;
+
+            class state {
+                public:
+                    state():future_(promise_.get_future().share()),done_(false) {}
+
+                    void set_value(value_type v) {
+                        promise_.set_value(std::move(v));
+                        finish();
+                    }
+
+                    void set_exception(std::exception_ptr e) {
+                        promise_.set_exception(e);
+                        finish();
+                    }
+
+                    bool done() const {
+                        guard_t guard(mutex_);
+                        return done_;
+                    }
+
+                    // false if already complete (caller continues inline)
+                    bool then(std::function<void()> k) {
+                        guard_t guard(mutex_);
+                        if (done_) return false;
+                        continuation_ = std::move(k);
+                        return true;
+                    }
+
+                    const future_type& future() const {return future_;}
+
+                private:
+                    using guard_t = std::lock_guard<std::mutex>;
+
+                    std::promise<value_type> promise_;
+                    future_type future_;
+                    mutable std::mutex mutex_;
+                    bool done_;
+                    std::function<void()> continuation_;
+
+                    void finish() {
+                        std::function<void()> k;
+                        {
+                            guard_t guard(mutex_);
+                            done_ = true;
+                            k.swap(continuation_);
+                        }
+                        if (k) k();
+                    }
+            };
+
+            async_result():state_(std::make_shared<state>()) {}
+
+            const std::shared_ptr<state>& shared_state() const {return state_;}
+
+            bool ready() const {return state_->done();}
+            future_type get_future() const {return state_->future();}
+
+            // blocks until complete, rethrows a failure
+            value_type get() const {return state_->future().get();}
+
+#ifdef CPPSTDDB_COROUTINES
+            bool await_ready() const {return ready();}
+            bool await_suspend(std::coroutine_handle<> h) const {
+                return state_->then([h] {h.resume();});
+            }
+            value_type await_resume() const {return get();}
+#endif
+
+        private:
+            std::shared_ptr<state> state_;
+    };
+
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef CPPSTDDB_COLUMN_INDEX_H
+#define CPPSTDDB_COLUMN_INDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+   Column name to position lookup for a result set. Built once from the
+   driver describe names into a flat open addressed table (power of two
+   size, at most half full, linear probing), so a lookup is one hash and
+   usually one compare. Names compare case insensitively (ascii), as SQL
+   identifiers do.
+ */
+
+namespace cppstddb {
+
+    class column_index {
+        public:
+            using string = std::string;
+
+            enum {npos = -1};
+
+            column_index():built_(false),mask_(0) {}
+
+            bool built() const {return built_;}
+            size_t size() const {return names_.size();}
+
+            void build(const std::vector<string>& names) {
+                names_.clear();
+                names_.reserve(names.size());
+                for(auto& n : names) names_.push_back(fold(n.data(), n.size()));
+
+                size_t capacity = 8;
+                while (capacity < 2 * names_.size()) capacity <<= 1;
+                mask_ = capacity - 1;
+                slots_.assign(capacity, int(npos));
+
+                for(size_t i = 0; i != names_.size(); ++i) {
+                    auto& n = names_[i];
+                    auto s = hash(n.data(), n.size()) & mask_;
+                    while (slots_[s] != npos) {
+                        if (names_[slots_[s]] == n) break; // duplicate name: first column wins
+                        s = (s + 1) & mask_;
+                    }
+                    if (slots_[s] == npos) slots_[s] = static_cast<int>(i);
+                }
+                built_ = true;
+            }
+
+            // column position or npos
+            int find(const char* name, size_t len) const {
+                if (slots_.empty()) return npos;
+                auto s = hash(name, len) & mask_;
+                for(;;) {
+                    auto i = slots_[s];
+                    if (i == npos) return npos;
+                    if (equal(names_[i], name, len)) return i;
+                    s = (s + 1) & mask_;
+                }
+            }
+
+        private:
+            bool built_;
+            size_t mask_;
+            std::vector<int> slots_;
+            std::vector<string> names_; // folded
+
+            static char lower(char c) {return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;}
+
+            static string fold(const char* s, size_t len) {
+                string r(s, len);
+                for(auto& c : r) c = lower(c);
+                return r;
+            }
+
+            // fnv-1a over the folded name
+            static size_t hash(const char* s, size_t len) {
+                uint64_t h = 14695981039346656037ULL;
+                for(size_t i = 0; i != len; ++i) {
+                    h ^= static_cast<unsigned char>(lower(s[i]));
+                    h *= 1099511628211ULL;
+                }
+                return static_cast<size_t>(h ^ (h >> 32));
+            }
+
+            static bool equal(const string& folded, const char* s, size_t len) {
+                if (folded.size() != len) return false;
+                for(size_t i = 0; i != len; ++i) if (folded[i] != lower(s[i])) return false;
+                return true;
+            }
+    };
+
+    // a column name resolved to a position once (see rowset::column)
+    class column_ref {
+        public:
+            explicit column_ref(size_t idx):idx_(idx) {}
+            size_t index() const {return idx_;}
+        private:
+            size_t idx_;
+    };
+
+}
+
+#endif
@@ -19,6 +19,16 @@ namespace cppstddb {
             auto day() const {return day_;}
     };
 
+    // days since 1970-01-01 (proleptic gregorian)
+    inline int days_from_civil(const date_t& d) {
+        int y = d.year() - (d.month() <= 2);
+        int era = (y >= 0 ? y : y - 399) / 400;
+        int yoe = y - era * 400;
+        int doy = (153 * (d.month() + (d.month() > 2 ? -3 : 9)) + 2) / 5 + d.day() - 1;
+        int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
     inline std::ostream& operator<<(std::ostream &os, const date_t& d) {
         // very crude
         os << d.year() << '-' << d.month() << '-' << d.day();
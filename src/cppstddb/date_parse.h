@@ -32,12 +32,16 @@ namespace cppstddb {
 
         static int parseYyyyMmDd(const char *zDate, DateTime *p);
 
-        template<class S> date_t date_parse(const S& s) {
-            DateTime dt;
-            parseYyyyMmDd(s.c_str(), &dt);
+        inline date_t date_parse(const char* s) {
+            DateTime dt = DateTime();
+            parseYyyyMmDd(s, &dt);
             return date_t(dt.Y,dt.M,dt.D);
         }
 
+        template<class S> date_t date_parse(const S& s) {
+            return date_parse(s.c_str());
+        }
+
 
         /*
          ** Convert zDate into one or more integers according to the conversion
@@ -1,12 +1,39 @@
+
 #ifndef CPPSTDDB_ENDIAN_H
 #define CPPSTDDB_ENDIAN_H
 
-static int big4_to_native(const void *d) {
+#include <cstdint>
+
+inline int big4_to_native(const void *d) {
     // for 4 byte ints
     // read https://commandcenter.blogspot.fr/2012/04/byte-order-fallacy.html
-    auto a = static_cast<const char *>(d);
+    auto a = static_cast<const unsigned char *>(d);
     return (a[3]<<0) | (a[2]<<8) | (a[1]<<16) | (a[0]<<24);
 }
 
-#endif
+inline int64_t big8_to_native(const void *d) {
+    auto a = static_cast<const unsigned char *>(d);
+    uint64_t v = 0;
+    for(int i = 0; i != 8; ++i) v = (v << 8) | a[i];
+    return static_cast<int64_t>(v);
+}
+
+inline void native_to_big2(int16_t v, void *d) {
+    auto a = static_cast<unsigned char *>(d);
+    a[0] = static_cast<uint16_t>(v) >> 8;
+    a[1] = static_cast<uint16_t>(v);
+}
 
+inline void native_to_big4(int32_t v, void *d) {
+    auto a = static_cast<unsigned char *>(d);
+    auto u = static_cast<uint32_t>(v);
+    a[0] = u >> 24; a[1] = u >> 16; a[2] = u >> 8; a[3] = u;
+}
+
+inline void native_to_big8(int64_t v, void *d) {
+    auto a = static_cast<unsigned char *>(d);
+    auto u = static_cast<uint64_t>(v);
+    for(int i = 7; i >= 0; --i, u >>= 8) a[i] = static_cast<unsigned char>(u);
+}
+
+#endif
@@ -9,22 +9,85 @@
 #endif
 
 #include <memory>
+#include <tuple>
+#include <utility>
+#include <algorithm>
 #include <exception>
+#include <mutex>
+#include <unordered_map>
 #include <cppstddb/log.h>
+#include <cppstddb/pool.h>
+#include <cppstddb/arrow.h>
+#include <cppstddb/column_index.h>
+#include <cppstddb/async.h>
+#include <cppstddb/metadata_cache.h>
+#include <cppstddb/parallel.h>
 #include "database_error.h"
 #include <iostream>
 #include <cppstddb/util.h>
 #include <cppstddb/date.h>
 
 namespace cppstddb {
+#ifdef _MSC_VER
+    using string_view = std::string_view;
+#else
+    using string_view = std::experimental::string_view;
+#endif
+
     enum value_type {
         value_undef,
         value_int,
         value_string,
         value_date,
-        value_variant,
+        value_variant, // type decided per row (see sqlite)
+        value_int64,
+        value_double,
+        value_blob,
+    };
+
+    // view of a binary column value in driver owned memory,
+    // valid until the rowset moves on
+    class blob_view {
+        public:
+            blob_view():data_(nullptr),size_(0) {}
+            blob_view(const void* data, size_t size):data_(static_cast<const uint8_t*>(data)),size_(size) {}
+
+            const uint8_t* data() const {return data_;}
+            size_t size() const {return size_;}
+            bool empty() const {return size_ == 0;}
+            const uint8_t* begin() const {return data_;}
+            const uint8_t* end() const {return data_ + size_;}
+
+        private:
+            const uint8_t* data_;
+            size_t size_;
     };
 
+    // hex digits
+    inline std::ostream& operator<<(std::ostream& os, const blob_view& b) {
+        static const char digits[] = "0123456789abcdef";
+        for(auto c : b) os << digits[c >> 4] << digits[c & 15];
+        return os;
+    }
+
+    // how a statement's result is transferred (see statement::mode)
+    enum class fetch_mode {
+        driver_default,
+        buffered,   // whole result client side before the first row
+        streaming,  // rows arrive while they are consumed, bounded memory
+        cursor,     // server side cursor, rows prefetched in blocks (see statement::prefetch)
+    };
+
+    // column type expected for a C++ type in typed rowsets
+    template<class T> struct value_type_of {};
+    template<> struct value_type_of<int> {static const value_type value = value_int;};
+    template<> struct value_type_of<std::string> {static const value_type value = value_string;};
+    template<> struct value_type_of<string_view> {static const value_type value = value_string;};
+    template<> struct value_type_of<date_t> {static const value_type value = value_date;};
+    template<> struct value_type_of<int64_t> {static const value_type value = value_int64;};
+    template<> struct value_type_of<double> {static const value_type value = value_double;};
+    template<> struct value_type_of<blob_view> {static const value_type value = value_blob;};
+
     class default_policy {
         public:
             using string = std::string;
@@ -33,11 +96,17 @@ namespace cppstddb {
 
 namespace cppstddb { namespace front {
 
+    static const log_category db_log_category = log_category::front;
+
     template<class D> class connection;
     template<class D> class statement;
+    template<class D> class pipeline;
     template<class D> class rowset;
     template<class D> class rowset_iterator;
+    template<class D, class... T> class typed_rowset;
     template<class D> class row;
+    template<class D> class row_view;
+    template<class D> struct cell;
     template<class D> class field;
 
 
@@ -49,24 +118,89 @@ namespace cppstddb { namespace front {
         }
 
 
+    // field_type<T>::as where the driver converts to T. A driver without the
+    // conversion never reports columns of that type, so the fallback is unreachable
+    template<class T, class D> auto convert_field(const typename D::rowset& r, const cell<D>& c, int)
+        -> decltype(D::template field_type<T>::as(r, c)) {
+            return D::template field_type<T>::as(r, c);
+        }
+
+    template<class T, class D> T convert_field(const typename D::rowset&, const cell<D>& c, long) {
+        raise_error("unsupported type", c.bind_.type);
+        return T();
+    }
+
+    // connection::reset where the driver has one: puts a pooled connection
+    // back in its initial state, false when it should be closed instead
+    template<class C> auto reset_connection(C& c, int) -> decltype(c.reset()) {return c.reset();}
+    template<class C> bool reset_connection(C&, long) {return true;}
+
+
     template<class D> class basic_database {
         public:
             using database_type = D;
             using policy_type = typename database_type::policy_type;
             using string = std::string;
-#ifdef _MSC_VER
-            using string_view = std::string_view;
-#else
-            using string_view = std::experimental::string_view;
-#endif
+            using string_view = cppstddb::string_view;
             using connection_t = connection<database_type>;
             using rowset_t = rowset<database_type>;
+            using connection_type = typename database_type::connection;
+            using pool_type = connection_pool<connection_type>;
 
             struct data_t {
                 database_type db;
                 string uri;
-                data_t() {}
-                data_t(const string& uri_):uri(uri_) {}
+                source src; // uri, parsed once for every connection
+                std::shared_ptr<pool_type> pool; // the writer when there are readers
+                std::shared_ptr<pool_type> readers;
+                std::mutex sources_mutex;
+                std::unordered_map<string, source> sources; // other uris given to connection(uri)
+
+                static const size_t max_sources = 16;
+
+                data_t(const string& uri_, const pool_options& options):
+                    uri(uri_),
+                    src(uri.empty() ? source() : uri_to_source(uri)),
+                    pool(std::make_shared<pool_type>(
+                                factory(options.readers ? access_mode::writer : access_mode::read_write),
+                                writer_options(options),
+                                reset())) {
+                        // the writer (opened by its pool) sets up the database before readers open it
+                        if (!options.readers) return;
+                        auto reader_options = options;
+                        reader_options.max_size = options.readers;
+                        reader_options.min_size = std::min(options.min_size, options.readers);
+                        readers = std::make_shared<pool_type>(factory(access_mode::read_only), reader_options, reset());
+                    }
+
+                typename pool_type::factory_type factory(access_mode access) {
+                    return [this, access] {
+                        auto s = src;
+                        s.access = access;
+                        return std::make_unique<connection_type>(db, s);
+                    };
+                }
+
+                static typename pool_type::reset_type reset() {
+                    return [](connection_type& c) {return reset_connection(c, 0);};
+                }
+
+                static pool_options writer_options(pool_options options) {
+                    if (options.readers) options.min_size = options.max_size = 1;
+                    return options;
+                }
+
+                pool_type& pool_for(bool read) {return read && readers ? *readers : *pool;}
+
+                // a connection uri parsed once per database, like the database's own
+                source source_for(const string& other) {
+                    if (other.empty() || other == uri) return src;
+                    std::lock_guard<std::mutex> guard(sources_mutex);
+                    auto i = sources.find(other);
+                    if (i != sources.end()) return i->second;
+                    if (sources.size() >= max_sources) sources.clear(); // crude bound, refilled on demand
+                    return sources.emplace(other, uri_to_source(other)).first->second;
+                }
             };
 
             //private:
@@ -75,26 +209,62 @@ namespace cppstddb { namespace front {
 
         public:
             basic_database():
-                data_(std::make_shared<data_t>()) {
+                data_(std::make_shared<data_t>(string(), pool_options())) {
                 }
 
-            basic_database(const string& uri):
-                data_(std::make_shared<data_t>(uri)) {
+            basic_database(const string& uri, const pool_options& options = pool_options()):
+                data_(std::make_shared<data_t>(uri, options)) {
                 }
 
             // helpful for testing
             string date_column_type() const {return data_->db.date_column_type();}
+            string placeholder(int n) const {return data_->db.placeholder(n);}
 
             auto uri() const {return data_->uri;}
+            auto& pool() const {return *data_->pool;}
+            auto& read_pool() const {return data_->pool_for(true);}
 
+            // connection() leases from the pool, create_connection() opens a dedicated one.
+            // with pool_options::readers, connection() is the writer and read_connection()
+            // leases a read only one
             auto connection() {return connection_t(*this,false);}
+            auto read_connection() {return connection_t(*this,false,true);}
             auto connection(const string& uri) {return connection_t(*this,uri,false);}
             auto create_connection() {return connection_t(*this,true);}
-            auto statement(const string &sql) {return connection().statement(sql);}
+
+            // queries go to a read only connection when there are readers
+            auto statement(const string &sql) {
+                return connection_t(*this,false,is_query(sql)).statement(sql);
+            }
 
             auto query(const string& sql) {
                 return statement(sql).query();
             }
+
+            // partitioned scan: sql takes the (inclusive) bounds of a key slice as
+            // its two parameters (where rowid >= ? and rowid <= ?), bounds_sql
+            // returns the smallest and largest key (select min(rowid), max(rowid)
+            // from t). slices run on up to the read pool's size of worker threads,
+            // each with its own read connection (see pool_options::readers), and
+            // the rows are merged as they arrive, or slice by slice when ordered
+            template<class... T> auto parallel_query(
+                    const string& sql,
+                    size_t partitions,
+                    const string& bounds_sql,
+                    bool ordered = false) {
+                std::vector<std::pair<int64_t,int64_t>> slices;
+                {
+                    auto con = read_connection();
+                    auto stmt = con.statement(bounds_sql);
+                    auto r = stmt.query().rows();
+                    if (!r.empty() && !r.front()[0].is_null()) {
+                        auto row = r.front();
+                        slices = key_slices(row[0].template as<int64_t>(), row[1].template as<int64_t>(), partitions);
+                    }
+                }
+                auto workers = read_pool().options().max_size;
+                return parallel_rowset<basic_database,T...>(*this, sql, slices, ordered, workers);
+            }
     };
 
     template<class D> class connection {
@@ -112,12 +282,14 @@ namespace cppstddb { namespace front {
             shared_ptr_type data_; // data_ -> ptr?
 
         public:
-            connection(database_t& database, bool create):
+            connection(database_t& database, bool create, bool read = false):
                 database_(database),
-                data_(std::make_shared<connection_type>(database_.data_->db, get_source(database_))) {
+                data_(create ?
+                        std::make_shared<connection_type>(database_.data_->db, get_source(database_)) :
+                        database_.data_->pool_for(read).acquire()) {
                 }
 
-            connection(database_t& database, const string& uri, bool create):
+            connection(database_t& database, const string& uri, bool):
                 database_(database),
                 data_(std::make_shared<connection_type>(database_.data_->db, get_source(database_, uri))) {
                 }
@@ -125,6 +297,25 @@ namespace cppstddb { namespace front {
             auto statement(const string &sql) {return statement_t(*this,sql);}
             auto database() {return database_;}
 
+            // batch round trips (drivers with a pipeline mode): statements run on
+            // this connection within the scope are sent without waiting for results
+            auto pipeline() {return front::pipeline<database_type>(*this);}
+
+            // bulk load (drivers with a bulk path): range of tuples, one value per column
+            template<class R> size_t copy_in(const string& table, const std::vector<string>& columns, const R& range) {
+                return data_->copy_in(table, columns, range);
+            }
+
+            // bulk insert (sqlite): multi-row inserts in transactions of commit_rows rows
+            template<class R> size_t insert_many(const string& table, const std::vector<string>& columns, const R& range, size_t commit_rows = 10000) {
+                return data_->insert_many(table, columns, range, commit_rows);
+            }
+
+            // bulk export into typed column batches: fn(column_batch&) per batch_rows rows
+            template<class... T, class F> void copy_out(const string& query, size_t batch_rows, F fn) {
+                data_->template copy_out<T...>(query, batch_rows, fn);
+            }
+
             auto query(const string& sql) {
                 return statement(sql).query();
             }
@@ -144,15 +335,60 @@ namespace cppstddb { namespace front {
         private:
 
             static source get_source(const database_t& db) {
-                return uri_to_source(db.uri());
+                return db.data_->src;
             }
 
             static source get_source(const database_t& db, const string& uri) {
-                return uri_to_source(uri.empty() ? db.uri() : uri);
+                return db.data_->source_for(uri);
             }
 
     };
 
+    // scope of a connection's pipeline mode. results are read in order when
+    // a rowset needs one, on sync() and at the end of the scope
+    template<class D> class pipeline {
+        public:
+            using database_type = D;
+            using connection_t = connection<database_type>;
+
+            pipeline(connection_t& connection):
+                connection_(connection),
+                active_(true) {
+                    connection_.data_->enter_pipeline();
+                }
+
+            pipeline(pipeline&& other):
+                connection_(other.connection_),
+                active_(other.active_) {
+                    other.active_ = false;
+                }
+
+            pipeline(const pipeline&) = delete;
+            pipeline& operator=(const pipeline&) = delete;
+
+            ~pipeline() {
+                if (!active_) return;
+                try {
+                    close();
+                } catch (const std::exception& e) {
+                    DB_ERROR("pipeline: " << e.what());
+                }
+            }
+
+            // read all results queued so far; throws on the first failed command
+            void sync() {connection_.data_->sync();}
+
+            // leave pipeline mode, reporting failures (the destructor only logs them)
+            void close() {
+                active_ = false;
+                connection_.data_->exit_pipeline();
+            }
+
+        private:
+            connection_t connection_;
+            bool active_;
+    };
+
     template<class D> class statement {
         public:
             using database_type = D;
@@ -193,21 +429,54 @@ namespace cppstddb { namespace front {
                 state_ = state_prepared;
             }
 
+            // applies to the following executions
+            statement& mode(fetch_mode m) {
+                data_->mode(m);
+                return *this;
+            }
+
+            // rows transferred per server round trip when streaming or using a cursor
+            statement& prefetch(size_t rows) {
+                data_->prefetch(rows);
+                return *this;
+            }
+
             auto query() {
                 data_->query();
                 state_ = state_executed;
                 return *this;
             }
 
-            template<typename... Args> statement& query(Args... args) {
-                //info("HERE: ", args...);
+            template<typename... Args> statement& query(const Args&... args) {
                 data_->query(args...);
                 state_ = state_executed;
                 return *this;
             }
 
+            // execute without blocking the calling thread (drivers with an async path).
+            // the result holds a copy of this statement, which keeps the connection
+            // leased until completion; don't use the statement before then
+            template<typename... Args> async_result<statement> async_query(const Args&... args) {
+                async_result<statement> result;
+                state_ = state_executed;
+                auto self = *this;
+                auto state = result.shared_state();
+                data_->async_query(
+                        [self, state](std::exception_ptr e) {
+                            if (e) state->set_exception(e); else state->set_value(self);
+                        },
+                        args...);
+                return result;
+            }
 
-            auto rows() {return rowset_t(*this,1);}
+
+            // row_array_size: rows fetched from the driver per call
+            auto rows(int row_array_size = 1) {return rowset_t(*this,row_array_size);}
+
+            // rows as std::tuple<T0,T...>, column types checked once up front
+            template<class T0, class... T> auto rows(int row_array_size = 1) {
+                return typed_rowset<database_type,T0,T...>(rowset_t(*this,row_array_size));
+            }
     };
 
     template<class D> class rowset {
@@ -221,6 +490,8 @@ namespace cppstddb { namespace front {
             //alias ColumnSet = BasicColumnSet!(Driver,Policy);
             using shared_ptr = std::shared_ptr<rowset_type>;
             using iterator = rowset_iterator<database_type>;
+            using cell_t = cell<database_type>;
+            template<typename T> using field_type = typename database_type:: template field_type<T>;
 
             //private:
             using shared_ptr_type = std::shared_ptr<rowset_type>;
@@ -229,19 +500,51 @@ namespace cppstddb { namespace front {
             shared_ptr_type data_;
             int rows_fetched_;
             int row_idx_;
+            std::shared_ptr<column_index> columns_; // shared by copies, built on first name lookup
 
-        public:
-            rowset(statement_t& statement, int row_array_size):
+        private:
+            // the driver rowset and the (empty until used) column index in one allocation
+            struct shared_state {
+                shared_state(typename database_type::statement& stmt, int row_array_size):
+                    rows(stmt, row_array_size) {}
+                rowset_type rows;
+                column_index columns;
+            };
+
+            rowset(statement_t& statement, int row_array_size, std::shared_ptr<shared_state> state):
                 statement_(statement),
                 row_array_size_(row_array_size),
+                data_(state, &state->rows),
                 row_idx_(0),
-                data_(std::make_shared<rowset_type>(*statement_.data_, row_array_size_)) {
+                columns_(state, &state->columns) {
                     //if (!stmt_.hasRows) throw new DatabaseException("not a result query");
                     rows_fetched_ = data_->fetch();
                 }
 
+        public:
+            rowset(statement_t& statement, int row_array_size):
+                rowset(statement, row_array_size, std::make_shared<shared_state>(*statement.data_, row_array_size)) {
+                }
+
             int width() {return data_->columns;}
 
+            const column_index& columns() {
+                if (!columns_->built()) {
+                    std::vector<string> names;
+                    names.reserve(width());
+                    for(int i = 0; i != width(); ++i) names.push_back(string(data_->name(i)));
+                    columns_->build(names);
+                }
+                return *columns_;
+            }
+
+            // resolve a column name once, for use as row[ref] in a loop
+            column_ref column(const string_view& name) {
+                auto i = columns().find(name.data(), name.size());
+                if (i == column_index::npos) raise_error("unknown column", name);
+                return column_ref(i);
+            }
+
             // length will be for the number of rows (if defined)
             int length() {
                 //throw new Exception("not a completed/detached rowSet");
@@ -308,9 +611,73 @@ namespace cppstddb { namespace front {
             auto front() {return row_t(*this);}
             void pop_front() {next();}
 
+            // reposition on row n (0 based) of a buffered result
+            void seek(size_t n) {
+                data_->seek(n);
+                rows_fetched_ = data_->fetch();
+                row_idx_ = 0;
+            }
+
             iterator begin() {return iterator(this);}
             iterator end() {return iterator(nullptr);}
 
+            // consume up to batch_rows rows into typed column buffers
+            column_batch fetch_batch(size_t batch_rows) {
+                column_batch batch;
+                auto& binds = data_->binds;
+                for(int c = 0; c != width(); ++c) {
+                    batch.add_column(data_->name(c), to_column_type(binds[c].type)).reserve(batch_rows);
+                }
+
+                for(size_t n = 0; n != batch_rows && !empty(); ++n) {
+                    for(int c = 0; c != width(); ++c) {
+                        auto& col = batch[c];
+                        auto cell = cell_t(binds[c], row_idx_, c);
+                        if (data_->is_null(cell)) {
+                            col.append_null();
+                            continue;
+                        }
+                        switch(col.type()) {
+                            case column_type::int32:
+                                col.append(field_type<int>::as(*data_, cell));
+                                break;
+                            case column_type::date32:
+                                col.append(days_from_civil(field_type<date_t>::as(*data_, cell)));
+                                break;
+                            case column_type::int64:
+                                col.append(convert_field<int64_t>(*data_, cell, 0));
+                                break;
+                            case column_type::float64:
+                                col.append(convert_field<double>(*data_, cell, 0));
+                                break;
+                            case column_type::binary: {
+                                auto v = convert_field<blob_view>(*data_, cell, 0);
+                                col.append(reinterpret_cast<const char*>(v.data()), v.size());
+                                break;
+                            }
+                            case column_type::utf8: {
+                                auto v = field_type<string_view>::as(*data_, cell);
+                                col.append(v.data(), v.size());
+                                break;
+                            }
+                        }
+                    }
+                    next();
+                }
+                return batch;
+            }
+
+            static column_type to_column_type(value_type type) {
+                switch(type) {
+                    case value_int: return column_type::int32;
+                    case value_date: return column_type::date32;
+                    case value_int64: return column_type::int64;
+                    case value_double: return column_type::float64;
+                    case value_blob: return column_type::binary;
+                    default: return column_type::utf8;
+                }
+            }
+
             template<class OS> void write(OS &os) {
                 os << "+--" << "\n";
                 for(auto row : *this) {
@@ -330,19 +697,20 @@ namespace cppstddb { namespace front {
             using database_type = D;
             using policy_type = typename database_type::policy_type;
             using rowset_t = rowset<database_type>;
-            using row_t = row<database_type>;
+            using row_view_t = row_view<database_type>;
 
             typedef std::ptrdiff_t difference_type;
-            typedef rowset_t value_type;
-            typedef rowset_t reference;
-            typedef rowset_t* pointer;
+            typedef row_view_t value_type;
+            typedef row_view_t reference;
+            typedef row_view_t* pointer;
             typedef std::input_iterator_tag iterator_category;
 
         private:
             rowset_t* rowset_;
         public:
             rowset_iterator(rowset_t* rowset):rowset_(rowset) {}
-            auto operator*() {return row_t(*rowset_);}
+            // borrows the rowset: no copy, no refcounting per row
+            row_view_t operator*() const {return row_view_t(*rowset_);}
             rowset_iterator& operator ++() {
                 rowset_->next();
                 return *this;
@@ -355,39 +723,128 @@ namespace cppstddb { namespace front {
             bool operator!=(const rowset_iterator& rhs) const {return !operator==(rhs);}
     };
 
+    template<class D, class... T> class typed_rowset {
+        public:
+            using database_type = D;
+            using rowset_t = rowset<database_type>;
+            using cell_t = cell<database_type>;
+            using tuple_type = std::tuple<T...>;
+            template<typename U> using field_type = typename database_type:: template field_type<U>;
+
+            class iterator {
+                public:
+                    typedef std::ptrdiff_t difference_type;
+                    typedef tuple_type value_type;
+                    typedef tuple_type reference;
+                    typedef tuple_type* pointer;
+                    typedef std::input_iterator_tag iterator_category;
+
+                    iterator(typed_rowset* rows):rows_(rows) {}
+                    tuple_type operator*() const {return rows_->front();}
+                    iterator& operator++() {
+                        rows_->pop_front();
+                        return *this;
+                    }
+                    bool operator==(const iterator& rhs) const {
+                        return
+                            (rows_ && !rows_->empty()) ==
+                            (rhs.rows_ && !rhs.rows_->empty());
+                    }
+                    bool operator!=(const iterator& rhs) const {return !operator==(rhs);}
+
+                private:
+                    typed_rowset* rows_;
+            };
+
+            typed_rowset(rowset_t rows):rows_(rows) {
+                if (rows_.width() != sizeof...(T)) raise_error("typed rowset: column count mismatch", rows_.width());
+                check_types(std::index_sequence_for<T...>());
+            }
+
+            int width() {return sizeof...(T);}
+            bool empty() const {return rows_.empty();}
+            tuple_type front() const {return get(std::index_sequence_for<T...>());}
+            void pop_front() {rows_.next();}
+
+            iterator begin() {return iterator(this);}
+            iterator end() {return iterator(nullptr);}
+
+        private:
+            rowset_t rows_;
+
+            template<size_t... I> void check_types(std::index_sequence<I...>) {
+                auto& binds = rows_.data_->binds;
+                const value_type requested[] = {value_type_of<T>::value...};
+                for(size_t i = 0; i != sizeof...(T); ++i) {
+                    if (!database_type::accepts(binds[i].type, requested[i])) {
+                        raise_error("typed rowset: column type mismatch at column", i);
+                    }
+                }
+            }
+
+            // conversions resolved at compile time, one field_type call per column
+            template<size_t... I> tuple_type get(std::index_sequence<I...>) const {
+                auto& r = *rows_.data_;
+                return tuple_type(field_type<T>::as(r, cell_t(r.binds[I], rows_.row_idx_, I))...);
+            }
+    };
+
     template<class D> struct cell {
         public:
             using database_type = D;
             using policy_type = typename database_type::policy_type;
             using string = std::string;
-            using rowset_t = rowset<database_type>;
-            using row_t = row<database_type>;
             using bind_type = typename database_type::bind_type;
 
             bind_type& bind_;
             int row_idx_;
             size_t idx_;
 
-            cell(row_t& r, bind_type& b, size_t idx):
+            cell(bind_type& b, int row_idx, size_t idx):
                 bind_(b),
-                idx_(idx),
-                row_idx_(r.rows_.row_idx_) {}
+                row_idx_(row_idx),
+                idx_(idx) {}
 
             //auto bind() {return bind_;}
             //auto rowIdx() {return rowIdx_;}
     };
 
+    // non-owning view of the current row of a rowset; what iteration yields.
+    // valid while the rowset is alive and positioned on the row
+    template<class D> class row_view {
+        public:
+            using database_type = D;
+            using rowset_t = rowset<database_type>;
+            using cell_t = cell<database_type>;
+            using field_t = field<database_type>;
+
+            row_view(rowset_t& rows):rows_(&rows) {}
+
+            auto width() const {return rows_->width();}
+
+            field_t operator[](size_t idx) const {
+                auto& r = *rows_->data_;
+                return field_t(r, cell_t(r.binds[idx], rows_->row_idx_, idx));
+            }
+
+            field_t operator[](const column_ref& ref) const {return operator[](ref.index());}
+
+            // hashed lookup per call: hoist with rowset::column in hot loops
+            field_t operator[](const string_view& name) const {return operator[](rows_->column(name));}
+
+        private:
+            rowset_t* rows_;
+    };
+
+    // owning row: keeps the rowset (and its connection) alive
     template<class D> class row {
         public:
             using database_type = D;
             using policy_type = typename database_type::policy_type;
             using string = std::string;
             using rowset_t = rowset<database_type>;
-            using cell_t = cell<database_type>;
             using field_t = field<database_type>;
-            //alias Cell = BasicCell!(Driver,Policy);
-            ////alias Value = BasicValue!(Driver,Policy);
-            //alias Column = BasicColumn!(Driver,Policy);
+            using row_view_t = row_view<database_type>;
 
             rowset_t rows_;
 
@@ -396,14 +853,9 @@ namespace cppstddb { namespace front {
 
             auto width() {return rows_.width();}
 
-            // auto into()
-
-            field_t operator[](size_t idx) {
-                // needs work
-                // sending a ptr to cell instead of reference (dangerous)
-                auto cell = cell_t(*this, rows_.data_->binds[idx], idx);
-                return field_t(*this, cell);
-            }
+            field_t operator[](size_t idx) {return row_view_t(rows_)[idx];}
+            field_t operator[](const column_ref& ref) {return row_view_t(rows_)[ref];}
+            field_t operator[](const string_view& name) {return row_view_t(rows_)[name];}
     };
 
 
@@ -412,20 +864,22 @@ namespace cppstddb { namespace front {
             using database_type = D;
             using policy_type = typename database_type::policy_type;
             using string = std::string;
-            using row_t = row<database_type>;
+            using rowset_type = typename database_type::rowset;
             using cell_t = cell<database_type>;
             using bind_type = typename database_type::bind_type;
             template<typename T> using field_type = typename database_type:: template field_type<T>;
 
-            row_t& row_; // reference currently, but watch out
+            rowset_type& rowset_; // borrowed from the driver rowset
             cell_t cell_;
             //alias Converter = .Converter!(Driver,Policy);
 
-            field(row_t& row, cell_t cell):row_(row),cell_(cell) {}
+            field(rowset_type& rowset, cell_t cell):rowset_(rowset),cell_(cell) {}
 
-            auto& rowset() const {return *row_.rows_.data_;}
+            rowset_type& rowset() const {return rowset_;}
 
-            auto type() const {return cell_.bind_.type;}
+            // the type of this row's value where the driver decides it per row
+            value_type type() const {return row_type(rowset_, 0);}
+            bool is_null() const {return rowset().is_null(cell_);}
 
             template<class T> T as() const {
                 return field_type<T>::as(rowset(), cell_);
@@ -433,20 +887,31 @@ namespace cppstddb { namespace front {
 
             auto str() const {return as<string>();}
 
+            // view into driver owned memory, valid until the rowset moves on
+            auto view() const {return as<string_view>();}
+
             friend inline std::ostream& operator<<(std::ostream &os, const field& f) {
                 //os << "hello"; // problem at -O3
                 // improve
 
+                if (f.is_null()) return os; // printed empty, whatever the column type
                 switch(f.type()) {
                     case value_int: os << f.as<int>(); break;
-                    case value_string: os << f.as<string>(); break;
+                    case value_string: os << f.as<string_view>(); break;
                     case value_date: os << f.as<date_t>(); break;
+                    case value_int64: os << convert_field<int64_t>(f.rowset_, f.cell_, 0); break;
+                    case value_double: os << convert_field<double>(f.rowset_, f.cell_, 0); break;
+                    case value_blob: os << convert_field<blob_view>(f.rowset_, f.cell_, 0); break;
                     default: raise_error("unsupported type", f.type());
                 }
                 //os << f.as<string>();
                 return os;
             }
 
+        private:
+            template<class R> auto row_type(const R& r, int) const -> decltype(r.row_type(cell_)) {return r.row_type(cell_);}
+            template<class R> value_type row_type(const R&, long) const {return cell_.bind_.type;}
+
     };
 
 }}
@@ -7,11 +7,37 @@
 #include <sstream>
 #include <iostream>
 #include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
 
 /*
    Just a very simplistic log facility with specific features for this library
+
+   By default messages are written synchronously under a lock. In async mode
+   (log_impl::async, or CPPSTDDB_LOG_ASYNC=drop|block) each thread appends to
+   its own lock free ring and a writer thread drains the rings in batches, one
+   write per batch, to the same stream as synchronous writes unless given
+   another. Order is kept per thread, not across threads.
+
+   Each component logs under its own category, whose level can be set apart
+   from the rest (log_impl::level(category, name), or for example
+   CPPSTDDB_LOG_LEVEL_SQLITE=TRACE). The category of a DB_* macro is the
+   db_log_category found by name lookup where it is used.
+
+   CPPSTDDB_LOG_FLOOR (0 none .. 5 trace) removes the macros of less severe
+   levels at compile time, for example -DCPPSTDDB_LOG_FLOOR=3 keeps info and
+   above and leaves no trace of DB_DEBUG/DB_TRACE in the code.
  */
 
+#ifndef CPPSTDDB_LOG_FLOOR
+#define CPPSTDDB_LOG_FLOOR 5
+#endif
+
 namespace cppstddb {
 
     std::string environment_variable(const std::string &name);
@@ -71,6 +97,106 @@ namespace cppstddb {
         return os;
     }
 
+    enum class log_category {
+        general,
+        front,
+        pool,
+        sqlite,
+        mysql,
+        postgres,
+        oracle,
+    };
+
+    struct log_category_info {
+        static const size_t count = 7;
+
+        // upper case, as in CPPSTDDB_LOG_LEVEL_<name>
+        static const char* name(log_category c) {
+            static const char* const names[count] = {"GENERAL", "FRONT", "POOL", "SQLITE", "MYSQL", "POSTGRES", "ORACLE"};
+            return names[static_cast<int>(c)];
+        }
+    };
+
+    // the category of DB_* macros in this namespace (see top)
+    static const log_category db_log_category = log_category::general;
+
+    // async mode: what a thread does when its ring is full
+    enum class log_overflow {
+        drop,   // discard the message (counted and reported)
+        block,  // wait for the writer
+    };
+
+    // single producer (the owning thread), single consumer (the writer) ring
+    // of variable size records: an 8 byte header, then the text, padded to 8
+    class log_ring {
+        public:
+            static const size_t capacity = 1 << 16;
+            static const size_t max_message = capacity / 4; // longer ones are truncated
+
+            log_ring():head_(0),tail_(0),dropped_(0) {}
+
+            bool push(log_level level, const char* s, size_t n) {
+                if (n > max_message) n = max_message;
+                auto need = record_size(n);
+                auto head = head_.load(std::memory_order_relaxed);
+                auto tail = tail_.load(std::memory_order_acquire);
+                auto pos = head & (capacity - 1);
+                auto contiguous = capacity - pos;
+                auto total = need <= contiguous ? need : contiguous + need;
+                if (capacity - (head - tail) < total) return false;
+                if (need > contiguous) {
+                    put_header(pos, skip, 0); // rest of the buffer unused, record at the start
+                    head += contiguous;
+                    pos = 0;
+                }
+                put_header(pos, static_cast<uint32_t>(n), static_cast<uint32_t>(level));
+                memcpy(data_ + pos + header_size, s, n);
+                head_.store(head + need, std::memory_order_release);
+                return true;
+            }
+
+            void drop() {dropped_.fetch_add(1, std::memory_order_relaxed);}
+            size_t take_dropped() {return dropped_.exchange(0, std::memory_order_relaxed);}
+
+            bool empty() const {
+                return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+            }
+
+            // consumer: f(level, data, size) for each record
+            template<class F> void drain(F f) {
+                auto tail = tail_.load(std::memory_order_relaxed);
+                auto head = head_.load(std::memory_order_acquire);
+                while (tail != head) {
+                    auto pos = tail & (capacity - 1);
+                    uint32_t h[2];
+                    memcpy(h, data_ + pos, header_size);
+                    if (h[0] == skip) {
+                        tail += capacity - pos;
+                        continue;
+                    }
+                    f(static_cast<log_level>(h[1]), data_ + pos + header_size, h[0]);
+                    tail += record_size(h[0]);
+                }
+                tail_.store(tail, std::memory_order_release);
+            }
+
+        private:
+            enum {header_size = 8};
+            static const uint32_t skip = 0xffffffff;
+
+            alignas(64) std::atomic<size_t> head_;
+            alignas(64) std::atomic<size_t> tail_;
+            std::atomic<size_t> dropped_;
+            alignas(8) char data_[capacity];
+
+            static size_t record_size(size_t n) {return (header_size + n + 7) & ~size_t(7);}
+
+            void put_header(size_t pos, uint32_t size, uint32_t level) {
+                uint32_t h[2] = {size, level};
+                memcpy(data_ + pos, h, header_size);
+            }
+    };
+
     class log_impl {
         public:
             using string = std::string;
@@ -82,13 +208,25 @@ namespace cppstddb {
             ~log_impl();
 
             bool is_level_enabled(log_level l) const {return level_ >= l;}
+            bool is_level_enabled(log_category c, log_level l) const {
+                return levels_[static_cast<int>(c)].load(std::memory_order_relaxed) >= l;
+            }
             log_level level() const {return level_;}
+            log_level level(log_category c) const {return levels_[static_cast<int>(c)];}
+            // every category
             void level(const string& level);
+            void level(log_category c, const string& level);
 
             void write(log_level level, const char* s, size_t n);
             void write_table(ostream &os, string &key) const;
             void clear();
 
+            // switch to async mode, writing to out, or the log stream when null (see top)
+            void async(log_overflow overflow, std::FILE* out = nullptr);
+            // back to synchronous writes, once everything queued is written
+            void sync();
+            bool is_async() const {return async_.load(std::memory_order_acquire);}
+
             struct log_msg {
                 log_level level;
                 const char *data;
@@ -100,13 +238,30 @@ namespace cppstddb {
             std::ostream& os_;
             bool enabled_;
             std::atomic<log_level> level_;
+            std::atomic<log_level> levels_[log_category_info::count];
             bool on_;
             string eoln_;
 
             mutable std::mutex mutex_;
 
+            // async mode
+            enum {batch_size = 1 << 16}; // bytes per write
+            std::atomic<bool> async_;
+            std::atomic<bool> stop_;
+            log_overflow overflow_;
+            std::FILE* out_;
+            std::thread writer_;
+            std::mutex rings_mutex_;
+            std::vector<std::shared_ptr<log_ring>> rings_;
+
             void write_internal(log_level level, const string &s);
             void write_internal(const log_msg& msg);
+
+            bool write_async(log_level level, const char* s, size_t n);
+            log_ring& local_ring();
+            void run();
+            bool drain(string& batch);
+            void write_batch(string& batch);
     };
 
     inline std::string environment_variable(const std::string &name) {
@@ -121,13 +276,27 @@ namespace cppstddb {
         enabled_(true),
         level_(log_level::warn),
         on_(true),
-        eoln_("\n")
+        eoln_("\n"),
+        async_(false),
+        stop_(false),
+        overflow_(log_overflow::drop),
+        out_(nullptr)
     {
+        for(auto& l : levels_) l = level_.load();
         auto l = environment_variable("CPPSTDDB_LOG_LEVEL");
         if (!l.empty()) level(l);
+        for(size_t i = 0; i != log_category_info::count; ++i) {
+            auto c = static_cast<log_category>(i);
+            auto cl = environment_variable(string("CPPSTDDB_LOG_LEVEL_") + log_category_info::name(c));
+            if (!cl.empty()) level(c, cl);
+        }
+        auto a = environment_variable("CPPSTDDB_LOG_ASYNC");
+        if (a == "drop") async(log_overflow::drop);
+        else if (a == "block") async(log_overflow::block);
     }
 
     inline log_impl::~log_impl() {
+        sync();
         if (!on_) return;
         os_.flush();
     }
@@ -141,9 +310,21 @@ namespace cppstddb {
         auto l = log_level_info::get(level).level;
         sstream s;
         s << "setting log level from " << level_ << " to " << l;
+        auto m = s.str();
+        write(log_level::info, m.data(), m.size());
         guard_t guard(mutex_);
-        write_internal(log_level::info, s.str());
         level_ = l;
+        for(auto& c : levels_) c = l;
+    }
+
+    inline void log_impl::level(log_category c, const string& level) {
+        auto l = log_level_info::get(level).level;
+        sstream s;
+        s << "setting " << log_category_info::name(c) << " log level from " << this->level(c) << " to " << l;
+        auto m = s.str();
+        write(log_level::info, m.data(), m.size());
+        guard_t guard(mutex_);
+        levels_[static_cast<int>(c)] = l;
     }
 
     inline void log_impl::write(log_level level, const char* s, size_t n) {
@@ -151,13 +332,126 @@ namespace cppstddb {
         msg.level = level;
         msg.data = s;
         msg.size = n;
+        if (!is_async()) {
+            guard_t guard(mutex_);
+            if (!is_async()) return write_internal(msg);
+        }
+        bool queued = write_async(level, s, n);
+        if (queued && is_async()) return;
+        // async mode ended meanwhile: sync() may have drained before this
+        // message was queued, or its ring is full with no writer left
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (is_async()) {
+            // async again since, its writer drains the rings
+            lock.unlock();
+            if (!queued) write(level, s, n);
+            return;
+        }
+        string rest; // what is still queued comes first
+        drain(rest);
+        write_batch(rest);
+        if (!queued) write_internal(msg);
+    }
+
+    inline void log_impl::async(log_overflow overflow, std::FILE* out) {
         guard_t guard(mutex_);
-        write_internal(msg);
+        if (is_async()) return;
+        os_.flush();
+        overflow_ = overflow;
+        out_ = out;
+        stop_ = false;
+        writer_ = std::thread([this] {run();});
+        async_.store(true, std::memory_order_release);
+    }
+
+    inline void log_impl::sync() {
+        guard_t guard(mutex_);
+        if (!is_async()) return;
+        async_.store(false, std::memory_order_release);
+        stop_.store(true, std::memory_order_release);
+        writer_.join();
+        string rest; // from threads that saw async mode just before it ended
+        drain(rest);
+        write_batch(rest);
     }
 
     // ====== private
     // note locking is generally done by public functions
 
+    // false when the ring stayed full until async mode ended
+    inline bool log_impl::write_async(log_level level, const char* s, size_t n) {
+        auto& ring = local_ring();
+        while (!ring.push(level, s, n)) {
+            if (!is_async()) return false;
+            if (overflow_ == log_overflow::drop) {
+                ring.drop();
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // registered once per thread; the writer drops it once the thread
+    // has exited and it is drained
+    inline log_ring& log_impl::local_ring() {
+        thread_local std::shared_ptr<log_ring> ring;
+        if (!ring) {
+            ring = std::make_shared<log_ring>();
+            std::lock_guard<std::mutex> guard(rings_mutex_);
+            rings_.push_back(ring);
+        }
+        return *ring;
+    }
+
+    inline void log_impl::run() {
+        string batch;
+        batch.reserve(batch_size + log_ring::max_message);
+        for(;;) {
+            // stop is read before the last drain, so nothing queued before sync() is lost
+            bool stopping = stop_.load(std::memory_order_acquire);
+            bool any = drain(batch);
+            write_batch(batch);
+            if (stopping) return;
+            if (!any) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    inline bool log_impl::drain(string& batch) {
+        bool any = false;
+        std::lock_guard<std::mutex> guard(rings_mutex_);
+        auto i = rings_.begin();
+        while (i != rings_.end()) {
+            auto& ring = **i;
+            ring.drain([&](log_level level, const char* s, size_t n) {
+                batch += log_level_info::get(level).name;
+                batch += ':';
+                batch.append(s, n);
+                batch += eoln_;
+                if (batch.size() >= batch_size) write_batch(batch);
+                any = true;
+            });
+            if (auto n = ring.take_dropped()) {
+                batch += "WARN:log: dropped " + std::to_string(n) + " messages" + eoln_;
+            }
+            // the thread is gone once the registry holds the only reference
+            if (i->use_count() == 1 && ring.empty()) i = rings_.erase(i); else ++i;
+        }
+        return any;
+    }
+
+    inline void log_impl::write_batch(string& batch) {
+        if (batch.empty()) return;
+        if (on_ && out_) {
+            std::fwrite(batch.data(), 1, batch.size(), out_);
+            std::fflush(out_);
+        } else if (on_) {
+            os_.write(batch.data(), batch.size());
+            os_.flush();
+        }
+        batch.clear();
+    }
+
     inline void log_impl::write_internal(log_level level, const string& s) {
         log_msg msg;
         msg.level = level;
@@ -180,29 +474,38 @@ namespace cppstddb {
             using streamsize = std::streamsize;
             using int_type = std::streambuf::int_type;
 
-            log_streambuf(log_level level):level_(level) {} 
-            ~log_streambuf() {log().write(level_, buf_.data(), buf_.size());}
+            // short messages stay in small_, longer ones move to buf_
+            log_streambuf(log_level level):level_(level) {setp(small_, small_ + sizeof(small_));}
+            ~log_streambuf() {
+                if (buf_.empty()) {
+                    log().write(level_, pbase(), pptr() - pbase());
+                } else {
+                    collect();
+                    log().write(level_, buf_.data(), buf_.size());
+                }
+            }
 
         protected:
             virtual int_type overflow(int_type c);
-            virtual streamsize xsputn(const char *s, streamsize n);
 
         private:
             log_level level_;
+            char small_[256];
             string buf_;
+
+            void collect() {
+                buf_.append(pbase(), pptr() - pbase());
+                setp(small_, small_ + sizeof(small_));
+            }
     };
 
 
     inline log_streambuf::int_type log_streambuf::overflow(int_type c) {
-        buf_.append(reinterpret_cast<const char*>(&c),1);
-        return c;
+        collect();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) buf_ += traits_type::to_char_type(c);
+        return traits_type::not_eof(c);
     }
 
-    inline log_streambuf::streamsize log_streambuf::xsputn(const char *s, streamsize n) {
-        buf_.append(s,n);
-        return n;
-    };
-
     class log_stream : public std::ostream {
         protected:
             log_streambuf buf_;
@@ -213,12 +516,37 @@ namespace cppstddb {
 
 }
 
-#define DB_LOG(L,X) if(L<=cppstddb::log().level()) {cppstddb::log_stream(L).stream() << X;}
-#define DB_ERROR(X) if(cppstddb::log().is_level_enabled(log_level::error)) {cppstddb::log_stream(log_level::error).stream() << X;}
-#define DB_WARN(X) if(cppstddb::log().is_level_enabled(log_level::warn)) {cppstddb::log_stream(log_level::warn).stream() << X;}
-#define DB_INFO(X) if(cppstddb::log().is_level_enabled(log_level::info)) {cppstddb::log_stream(log_level::info).stream() << X;}
-#define DB_DEBUG(X) if(cppstddb::log().is_level_enabled(log_level::debug)) {cppstddb::log_stream(log_level::debug).stream() << X;}
-#define DB_TRACE(X) if(cppstddb::log().is_level_enabled(log_level::trace)) {cppstddb::log_stream(log_level::trace).stream() << X;}
+#define DB_LOG(L,X) do {if(static_cast<int>(L)<=CPPSTDDB_LOG_FLOOR && cppstddb::log().is_level_enabled(db_log_category,L)) {cppstddb::log_stream(L).stream() << X;}} while (0)
+
+#if CPPSTDDB_LOG_FLOOR >= 1
+#define DB_ERROR(X) DB_LOG(cppstddb::log_level::error,X)
+#else
+#define DB_ERROR(X) do {} while (0)
+#endif
+
+#if CPPSTDDB_LOG_FLOOR >= 2
+#define DB_WARN(X) DB_LOG(cppstddb::log_level::warn,X)
+#else
+#define DB_WARN(X) do {} while (0)
+#endif
+
+#if CPPSTDDB_LOG_FLOOR >= 3
+#define DB_INFO(X) DB_LOG(cppstddb::log_level::info,X)
+#else
+#define DB_INFO(X) do {} while (0)
+#endif
+
+#if CPPSTDDB_LOG_FLOOR >= 4
+#define DB_DEBUG(X) DB_LOG(cppstddb::log_level::debug,X)
+#else
+#define DB_DEBUG(X) do {} while (0)
+#endif
+
+#if CPPSTDDB_LOG_FLOOR >= 5
+#define DB_TRACE(X) DB_LOG(cppstddb::log_level::trace,X)
+#else
+#define DB_TRACE(X) do {} while (0)
+#endif
 
 #endif
 
@@ -0,0 +1,113 @@
+#ifndef CPPSTDDB_METADATA_CACHE_H
+#define CPPSTDDB_METADATA_CACHE_H
+
+#include <cppstddb/log.h>
+#include <cppstddb/util.h>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+/*
+   Process wide cache of result metadata (the describe/bind vectors a driver
+   rowset builds for a query), keyed by a driver chosen string that names the
+   database and the sql. Entries are shared read only by every connection.
+
+   Entries are stamped with the schema epoch, which a driver bumps whenever
+   it executes a DDL statement (statements and plain exec alike); entries
+   from an older epoch are treated as missing. The epoch does not see schema
+   changes made by other processes, so a driver checks a hit against the
+   live result (postgres: column count and types, sqlite: column count and
+   declared types) and rebuilds on a mismatch. A change that keeps both (a
+   renamed column) is not detected.
+ */
+
+namespace cppstddb {
+
+    inline std::atomic<uint64_t>& schema_epoch_counter() {
+        static std::atomic<uint64_t> epoch(0);
+        return epoch;
+    }
+
+    inline uint64_t schema_epoch() {return schema_epoch_counter().load(std::memory_order_acquire);}
+
+    inline void bump_schema_epoch() {
+        auto e = schema_epoch_counter().fetch_add(1, std::memory_order_acq_rel) + 1;
+        DB_DEBUG("schema epoch: " << e);
+    }
+
+    // create, alter, drop, rename, truncate (leading keyword, any case)
+    inline bool is_ddl(const std::string& sql) {
+        static const char* const keywords[] = {"create", "alter", "drop", "rename", "truncate"};
+        return leading_keyword(sql, keywords);
+    }
+
+    template<class V> class metadata_cache {
+        public:
+            using value_type = V;
+            using value_ptr = std::shared_ptr<value_type>;
+            using string = std::string;
+
+            static const size_t default_capacity = 4096;
+            static const size_t shard_count = 16;
+
+            // one cache per metadata type (so per driver)
+            static metadata_cache& instance() {
+                static metadata_cache cache;
+                return cache;
+            }
+
+            metadata_cache(size_t capacity = default_capacity):capacity_(capacity / shard_count + 1) {}
+
+            // null when absent or from an older schema epoch
+            value_ptr find(const string& key) {
+                auto& s = shard_for(key);
+                guard_t guard(s.mutex);
+                auto i = s.entries.find(key);
+                if (i == s.entries.end()) return nullptr;
+                if (i->second.epoch != schema_epoch()) {
+                    s.entries.erase(i);
+                    return nullptr;
+                }
+                return i->second.value;
+            }
+
+            void insert(const string& key, value_ptr value) {
+                auto& s = shard_for(key);
+                guard_t guard(s.mutex);
+                if (s.entries.size() >= capacity_) s.entries.clear(); // crude bound, refilled on demand
+                s.entries[key] = entry{schema_epoch(), std::move(value)};
+            }
+
+            void clear() {
+                for(auto& s : shards_) {
+                    guard_t guard(s.mutex);
+                    s.entries.clear();
+                }
+            }
+
+        private:
+            using guard_t = std::lock_guard<std::mutex>;
+
+            struct entry {
+                uint64_t epoch;
+                value_ptr value;
+            };
+
+            struct alignas(64) shard {
+                std::mutex mutex;
+                std::unordered_map<string, entry> entries;
+            };
+
+            size_t capacity_; // per shard
+            shard shards_[shard_count];
+
+            shard& shard_for(const string& key) {
+                return shards_[std::hash<string>()(key) % shard_count];
+            }
+    };
+
+}
+
+#endif
@@ -3,12 +3,17 @@
 
 #include <cppstddb/front.h>
 #include <cppstddb/util.h>
+#include <cppstddb/statement_cache.h>
 #include <vector>
+#include <memory>
 #include <mysql/mysql.h>
+#include <mysql/errmsg.h>
 #include <cstring>
 
 namespace cppstddb { namespace mysql {
 
+    static const log_category db_log_category = log_category::mysql;
+
     namespace impl {
 
         template<class P> class database;
@@ -16,7 +21,9 @@ namespace cppstddb { namespace mysql {
         template<class P> class statement;
         template<class P> class rowset;
         template<class P> struct bind_type;
+        template<class P> struct result_arena;
         template<class P,class T> struct field;
+        template<class P,class T> struct param;
 
         template<class P> using cell_t = cppstddb::front::cell<database<P>>;
 
@@ -72,27 +79,37 @@ namespace cppstddb { namespace mysql {
                 }
 
                 string date_column_type() const {return "date";}
+                string placeholder(int) const {return "?";}
+                static bool accepts(value_type column, value_type requested) {return column == requested;}
         };
 
         template<class P> class connection {
             public:
                 using policy_type = P;
                 using database = database<policy_type>;
+                using statement_cache = statement_cache<MYSQL_STMT*>;
                 MYSQL *mysql;
             public:
                 database& db;
+                statement_cache statements;
 
-                connection(database& db_, const source& src):db(db_) {
+                connection(database& db_, const source& src):
+                    db(db_),
+                    statements([](MYSQL_STMT* stmt) {mysql_stmt_close(stmt);}) {
                     DB_TRACE("con");
                     mysql = check("mysql_init", mysql_init(nullptr));
 
-                    int port = 0;
-                    const char *unix_socket = nullptr;
+                    // a server path is the socket (mysql://%2Ftmp%2Fmysql.sock/db)
+                    auto socket = src.option("socket");
+                    if (!socket && src.is_unix_socket()) socket = &src.server;
+                    const char *unix_socket = socket ? socket->c_str() : nullptr;
+                    const char *host = src.is_unix_socket() ? "localhost" : src.server.c_str();
+                    unsigned int port = src.port;
                     unsigned long clientflag = 0L;
 
                     check("mysql_real_connect", mysql_real_connect(
                                 mysql,
-                                src.server.c_str(),
+                                host,
                                 src.username.c_str(),
                                 src.password.c_str(),
                                 src.database.c_str(),
@@ -103,9 +120,16 @@ namespace cppstddb { namespace mysql {
 
                 ~connection() {
                     DB_TRACE("~con");
+                    statements.clear();
                     if (mysql) mysql_close(mysql);
                 }
 
+                void begin() {
+                    DB_TRACE("begin");
+                    static const char sql[] = "start transaction";
+                    if (mysql_real_query(mysql, sql, sizeof(sql) - 1)) raise_error(mysql_error(mysql));
+                }
+
                 void commit() {
                   DB_TRACE("commit");
                   my_bool res = mysql_commit(mysql);
@@ -115,6 +139,16 @@ namespace cppstddb { namespace mysql {
                   DB_TRACE("rollback");
                   my_bool res = mysql_rollback(mysql);
                 }
+
+                // before the pool hands the connection out again: an open
+                // transaction is rolled back, a lost connection is dropped
+                bool reset() {
+                    auto error = mysql_errno(mysql);
+                    if (error == CR_SERVER_GONE_ERROR || error == CR_SERVER_LOST) return false;
+                    if (!(mysql->server_status & SERVER_STATUS_IN_TRANS)) return true;
+                    DB_DEBUG("reset: rolling back open transaction");
+                    return !mysql_rollback(mysql);
+                }
         };
 
         template<class P> class statement {
@@ -123,39 +157,110 @@ namespace cppstddb { namespace mysql {
                 using string = typename policy_type::string;
                 using connection = connection<policy_type>;
                 using rowset = rowset<policy_type>;
+                static const unsigned long default_prefetch_rows = 256;
+
+                connection& con;
                 MYSQL_STMT *stmt;
                 string sql;
                 int binds;
+                fetch_mode mode_;
+                unsigned long prefetch_rows;
+                std::shared_ptr<result_arena<policy_type>> arena; // result buffers, kept across executions
             public:
-                statement(connection& con, const string& sql_):sql(sql_),binds(0) {
+                statement(connection& con_, const string& sql_):
+                    con(con_),
+                    stmt(nullptr),
+                    sql(sql_),
+                    binds(0),
+                    mode_(fetch_mode::driver_default),
+                    prefetch_rows(default_prefetch_rows) {
                     DB_TRACE("stmt: " << sql);
-                    stmt = check("mysql_stmt_init", mysql_stmt_init(con.mysql));
                 }
 
                 ~statement() {
                     DB_TRACE("~stmt");
-                    if (stmt) mysql_stmt_close(stmt);
+                    if (stmt) {
+                        // hand the reset handle back to the connection for reuse
+                        mysql_stmt_free_result(stmt);
+                        mysql_stmt_reset(stmt);
+                        con.statements.put(sql, stmt);
+                    }
                 }
 
+                // driver_default/streaming: unbuffered, the connection is busy until
+                // the last row is read. cursor: read only server side cursor fetched
+                // prefetch_rows at a time. buffered: the whole result is stored
+                // client side on execute (mysql_stmt_store_result), which frees the
+                // connection and allows rowset::seek
+                void mode(fetch_mode m) {mode_ = m;}
+
+                void prefetch(size_t rows) {prefetch_rows = rows ? rows : 1;}
+
                 void prepare() {
-                    DB_TRACE("prepare sql: " << sql);
-                    check("mysql_stmt_prepare", stmt, mysql_stmt_prepare(
-                                stmt,
-                                sql.c_str(),
-                                sql.size()));
+                    if (stmt) return;
+                    if (!con.statements.take(sql, stmt)) {
+                        auto s = check("mysql_stmt_init", mysql_stmt_init(con.mysql));
+                        DB_TRACE("prepare sql: " << sql);
+                        auto ret = mysql_stmt_prepare(s, sql.c_str(), sql.size());
+                        if (ret) {
+                            DB_TRACE("mysql_stmt_prepare:" << ret);
+                            string msg = mysql_stmt_error(s);
+                            mysql_stmt_close(s);
+                            throw database_error("mysql_stmt_prepare", ret, msg);
+                        }
+                        stmt = s;
+                    }
 
                     binds = mysql_stmt_param_count(stmt);
                 }
 
                 statement& query() {
+                    mysql_stmt_free_result(stmt); // any previous result
+                    // attributes stick to the (cached) handle, so always set them
+                    unsigned long type = mode_ == fetch_mode::cursor ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR;
+                    check("mysql_stmt_attr_set", stmt, mysql_stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &type));
+                    if (mode_ == fetch_mode::cursor) {
+                        check("mysql_stmt_attr_set", stmt, mysql_stmt_attr_set(stmt, STMT_ATTR_PREFETCH_ROWS, &prefetch_rows));
+                    }
                     check("mysql_stmt_execute", stmt, mysql_stmt_execute(stmt));
+                    if (mode_ == fetch_mode::buffered && mysql_stmt_field_count(stmt)) {
+                        check("mysql_stmt_store_result", stmt, mysql_stmt_store_result(stmt));
+                    }
                     return *this;
                 }
 
+                bool buffered() const {return mode_ == fetch_mode::buffered;}
+
+                // result buffers for a row_array_size, built on first use and then
+                // reused (already bound) by every execution of this statement.
+                // rowsets share them, so a reshape leaves older rowsets their own
+                std::shared_ptr<result_arena<policy_type>> results(int row_array_size) {
+                    if (!arena || arena->row_array_size != row_array_size) {
+                        arena = std::make_shared<result_arena<policy_type>>(stmt, row_array_size);
+                    }
+                    return arena;
+                }
+
                 template <typename... Args>
-                statement& query(Args... args) {
-                  //info("HERE: ",args...);
-                  return *this;
+                statement& query(const Args&... args) {
+                    // the binds point straight at args, which outlive the execute
+                    if (int(sizeof...(Args)) != binds) raise_error("bind count mismatch", binds);
+                    param_binds.assign(sizeof...(Args), MYSQL_BIND());
+                    param_times.resize(sizeof...(Args));
+                    bind(0, args...);
+                    check("mysql_stmt_bind_param", stmt, mysql_stmt_bind_param(stmt, &param_binds[0]));
+                    return query();
+                }
+
+            private:
+                std::vector<MYSQL_BIND> param_binds;
+                std::vector<MYSQL_TIME> param_times;
+
+                void bind(int) {}
+
+                template<class T, class... Args> void bind(int idx, const T& t, const Args&... args) {
+                    param<policy_type,std::decay_t<const T>>::bind(param_binds[idx], param_times[idx], t);
+                    bind(idx + 1, args...);
                 }
         };
 
@@ -170,11 +275,12 @@ namespace cppstddb { namespace mysql {
         template<class P> struct bind_type {
             value_type type;
             int mysql_type;
-            int alloc_size;
-            void* data;
-            unsigned long length; // check type
-            my_bool is_null;
-            my_bool error;
+            int alloc_size; // per row
+            // all point into the statement's result arena, one entry per row slot
+            void* data; // row_array_size rows of alloc_size
+            unsigned long* length;
+            my_bool* is_null;
+            my_bool* error;
         };
 
         template<class P> struct bind_context {
@@ -243,119 +349,183 @@ namespace cppstddb { namespace mysql {
             {0,nullptr}
         };
 
-        template<class P> class rowset {
-            public:
-                using policy_type = P;
-                using cell_t = cell_t<policy_type>;
-                using statement = statement<policy_type>;
-                using bind_type = bind_type<policy_type>;
-                using bind_context = bind_context<policy_type>;
-                statement& stmt;
-                //Allocator *allocator;
-                unsigned int columns;
-
-                MYSQL_RES *result_metadata;
-                int status;
-
-                using describe_type = describe_type<policy_type>;
-                using describe_vector = std::vector<describe_type>;
-                using bind_vector = std::vector<bind_type>;
-                using mysql_bind_vector = std::vector<MYSQL_BIND>;
-
-                describe_vector describes;
-                bind_vector binds;
-                mysql_bind_vector mysql_binds;
-
-                //static const maxData = 256;
+        // result metadata, column binds and a single cache line aligned block
+        // holding every column's row slots, lengths and null/error flags.
+        // owned by the statement so that re-executions don't allocate or rebind.
+        // with more than one row slot, the handle stays bound to an extra
+        // staging slot and each fetched row is copied into its own slot
+        template<class P> struct result_arena {
+            using policy_type = P;
+            using bind_type = bind_type<policy_type>;
+            using bind_context = bind_context<policy_type>;
+            using describe_type = describe_type<policy_type>;
+            using describe_vector = std::vector<describe_type>;
+            using bind_vector = std::vector<bind_type>;
+            using mysql_bind_vector = std::vector<MYSQL_BIND>;
 
-            public:
-                rowset(statement& stmt_, int rowArraySize_):
-                    stmt(stmt_) {
-                        //allocator = stmt.allocator;
+            static const size_t line = 64;
 
-                        result_metadata =
-                            check("mysql_stmt_result_metadata",
-                                    mysql_stmt_result_metadata(stmt.stmt));
+            MYSQL_STMT* stmt;
+            int row_array_size;
+            int staging; // the slot mysql_stmt_fetch writes into
+            unsigned int columns;
+            MYSQL_RES *result_metadata;
+            describe_vector describes;
+            bind_vector binds;
+            mysql_bind_vector mysql_binds; // one set of columns per row slot
+            std::unique_ptr<char[]> memory;
+            bool bound; // result columns bound on the handle
+
+            result_arena(MYSQL_STMT* stmt_, int row_array_size_):
+                stmt(stmt_),
+                row_array_size(row_array_size_),
+                staging(row_array_size_ > 1 ? row_array_size_ : 0),
+                columns(0),
+                bound(false) {
+                    result_metadata = mysql_stmt_result_metadata(stmt);
+                    if (!result_metadata) return; // no result set
+                    columns = mysql_num_fields(result_metadata);
+                    DB_TRACE("columns: " << columns);
+                    build_describe();
+                    build_bind();
+                }
 
-                        if (!result_metadata) return; // check this
-                        columns = mysql_num_fields(result_metadata);
-                        DB_TRACE("columns: " << columns);
+            ~result_arena() {
+                if (result_metadata) mysql_free_result(result_metadata);
+            }
 
-                        build_describe();
-                        build_bind();
-                    }
+            result_arena(const result_arena&) = delete;
+            result_arena& operator=(const result_arena&) = delete;
 
-                ~rowset() {
-                    DB_TRACE("~rowset");
+            void build_describe() {
+                describes.reserve(columns);
 
-                    //foreach(b; bind) allocator.deallocate(b.data);
+                for(unsigned int i = 0; i != columns; ++i) {
+                    describes.push_back(describe_type());
+                    auto& d = describes.back();
 
-                    for(auto&& b : binds) {
-                        //DB_TRACE("free: " << ", data: " << b.data << ", size: " << b.alloc_size);
-                        free(b.data);
-                    }
+                    d.index = i;
+                    d.field = check("mysql_fetch_field", mysql_fetch_field(result_metadata));
+                    d.name = d.field->name;
 
-                    if (result_metadata) {
-                        check("mysql_free_result");
-                        mysql_free_result(result_metadata);
-                    }
+                    //DB_TRACE("describe: name: ", d.name, ", mysql type: ", d.field.type);
+                    DB_TRACE("describe: name: " << d.name);
                 }
+            }
 
-                void build_describe() {
-                    columns = mysql_stmt_field_count(stmt.stmt);
-
-                    describes.reserve(columns);
+            static size_t round_up(size_t n, size_t a) {return (n + a - 1) & ~(a - 1);}
 
-                    for(int i = 0; i != columns; ++i) {
-                        describes.push_back(describe_type());
-                        auto& d = describes.back();
+            void build_bind() {
+                binds.assign(columns, bind_type());
+                for(unsigned int i = 0; i != columns; ++i) {
+                    auto& b = binds[i];
+                    bind_context ctx(describes[i], b);
+                    ctx.row_array_size = row_array_size;
+                    binder(ctx);
+                    b.alloc_size = round_up(b.alloc_size, 8); // keep rows aligned
+                }
 
-                        d.index = i;
-                        d.field = check("mysql_fetch_field", mysql_fetch_field(result_metadata));
-                        d.name = d.field->name;
+                // layout: column data blocks (each on its own cache lines), then
+                // the lengths and the null and error flags of all row slots
+                int rows = staging + 1;
+                size_t slots = columns * rows;
+                size_t size = 0;
+                std::vector<size_t> offsets(columns);
+                for(unsigned int i = 0; i != columns; ++i) {
+                    offsets[i] = size;
+                    size += round_up(binds[i].alloc_size * rows, line);
+                }
+                size_t lengths = size;
+                size += round_up(slots * sizeof(unsigned long), line);
+                size_t nulls = size;
+                size += round_up(slots * sizeof(my_bool), line);
+                size_t errors = size;
+                size += slots * sizeof(my_bool);
+
+                memory.reset(new char[size + line]);
+                auto base = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(memory.get()), line));
+                memset(base, 0, size);
+                DB_TRACE("result arena: " << size << " bytes, columns: " << columns << ", rows: " << row_array_size);
+
+                for(unsigned int i = 0; i != columns; ++i) {
+                    auto& b = binds[i];
+                    b.data = base + offsets[i];
+                    b.length = reinterpret_cast<unsigned long*>(base + lengths) + i * rows;
+                    b.is_null = reinterpret_cast<my_bool*>(base + nulls) + i * rows;
+                    b.error = reinterpret_cast<my_bool*>(base + errors) + i * rows;
+                }
 
-                        //DB_TRACE("describe: name: ", d.name, ", mysql type: ", d.field.type);
-                        DB_TRACE("describe: name: " << d.name);
-                    }
+                mysql_binds.assign(columns, MYSQL_BIND());
+                for(unsigned int i = 0; i != columns; ++i) {
+                    auto& b = binds[i];
+                    auto& mb = mysql_binds[i];
+                    mb.buffer_type = static_cast<enum_field_types>(b.mysql_type); // fix
+                    mb.buffer = static_cast<char*>(b.data) + staging * b.alloc_size;
+                    mb.buffer_length = b.alloc_size;
+                    mb.length = &b.length[staging];
+                    mb.is_null = &b.is_null[staging];
+                    mb.error = &b.error[staging];
                 }
+            }
 
-                void build_bind() {
+            // bind the handle's result columns to the staging slot (once per handle)
+            void bind() {
+                if (bound || !columns) return;
+                check("mysql_stmt_bind_result", stmt, mysql_stmt_bind_result(stmt, &mysql_binds[0]));
+                bound = true;
+            }
 
-                    binds.reserve(columns);
+            // move the row just fetched into row slot
+            void take(int row) {
+                if (row == staging) return;
+                for(auto& b : binds) {
+                    auto n = b.length[staging];
+                    auto size = b.type == value_string && n < size_t(b.alloc_size) ? n : b.alloc_size;
+                    auto data = static_cast<char*>(b.data);
+                    memcpy(data + row * b.alloc_size, data + staging * b.alloc_size, size);
+                    b.length[row] = n;
+                    b.is_null[row] = b.is_null[staging];
+                    b.error[row] = b.error[staging];
+                }
+            }
+        };
 
-                    for(int i = 0; i != columns; ++i) {
-                        auto& d = describes[i];
-                        binds.push_back(bind_type());
-                        auto& b = binds.back();
+        template<class P> class rowset {
+            public:
+                using policy_type = P;
+                using cell_t = cell_t<policy_type>;
+                using statement = statement<policy_type>;
+                using bind_type = bind_type<policy_type>;
+                using result_arena = result_arena<policy_type>;
+                statement& stmt;
+                int row_array_size;
+                std::shared_ptr<result_arena> results;
+                result_arena& arena;
+                unsigned int columns;
+                int status;
 
-                        bind_context ctx(d,b);
-                        binder(ctx);
+                using describe_type = describe_type<policy_type>;
+                using describe_vector = std::vector<describe_type>;
+                using bind_vector = std::vector<bind_type>;
 
-                        //b.data = allocator.allocate(b.alloc_size);
+                describe_vector& describes;
+                bind_vector& binds;
 
-                        b.data = malloc(b.alloc_size);
-                        //DB_TRACE("malloc: " << i << ", data: " << b.data << ", size: " << b.alloc_size);
+            public:
+                rowset(statement& stmt_, int row_array_size_):
+                    stmt(stmt_),
+                    row_array_size(row_array_size_ > 0 ? row_array_size_ : 1),
+                    results(stmt_.results(row_array_size)),
+                    arena(*results),
+                    columns(arena.columns),
+                    status(0),
+                    describes(arena.describes),
+                    binds(arena.binds) {
+                        arena.bind();
                     }
 
-                    setup(binds, mysql_binds);
-                    my_bool result = mysql_stmt_bind_result(stmt.stmt, &mysql_binds[0]);
-                }
-
-
-                static void setup(bind_vector& binds, mysql_bind_vector& mysql_binds) {
-                    // make this efficient
-                    mysql_binds.assign(binds.size(), MYSQL_BIND());
-                    for(int i=0; i!=binds.size(); ++i) {
-                        auto& b = binds[i];
-                        auto& mb = mysql_binds[i];
-                        memset(&mb, 0, sizeof(MYSQL_BIND)); //header?
-                        mb.buffer_type = static_cast<enum_field_types>(b.mysql_type); // fix
-                        mb.buffer = b.data;
-                        mb.buffer_length = b.alloc_size;
-                        mb.length = &b.length;
-                        mb.is_null = &b.is_null;
-                        mb.error = &b.error;
-                    }
+                ~rowset() {
+                    DB_TRACE("~rowset");
                 }
 
                 //bool hasResult() {return result_metadata != null;}
@@ -365,20 +535,51 @@ namespace cppstddb { namespace mysql {
                 }
 
                 int next() {
+                    // mysql fetches a row at a time (from the client buffer, or
+                    // prefetch_rows per round trip with a cursor): gather a block
+                    int rows = 0;
+                    while (rows != row_array_size) {
+                        if (!fetch_row()) break;
+                        arena.take(rows++);
+                    }
+                    return rows;
+                }
+
+                bool fetch_row() {
                     status = check("mysql_stmt_fetch", stmt.stmt, mysql_stmt_fetch(stmt.stmt));
                     if (!status) {
-                        return 1;
+                        return true;
                     } else if (status == MYSQL_NO_DATA) {
                         //rows_ = row_count_;
-                        return 0;
+                        return false;
                     } else if (status == MYSQL_DATA_TRUNCATED) {
                         raise_error("mysql_stmt_fetch: truncation", status);
                     }
 
                     raise_error("mysql_stmt_fetch", stmt.stmt, status);
-                    return 0;
+                    return false;
+                }
+
+                const void* data(const cell_t& cell) const {
+                    return static_cast<const char*>(cell.bind_.data) + cell.row_idx_ * cell.bind_.alloc_size;
                 }
 
+                size_t length(const cell_t& cell) const {
+                    return cell.bind_.length[cell.row_idx_];
+                }
+
+                bool is_null(const cell_t& cell) const {
+                    return cell.bind_.is_null[cell.row_idx_] != 0;
+                }
+
+                // buffered results only: the next fetch starts at row n
+                void seek(size_t n) {
+                    if (!stmt.buffered()) raise_error("seek: result is not buffered");
+                    mysql_stmt_data_seek(stmt.stmt, n);
+                }
+
+                size_t row_count() const {return stmt.buffered() ? mysql_stmt_num_rows(stmt.stmt) : 0;}
+
                 auto name(size_t idx) {
                     return describes[idx].name;
                 }
@@ -390,23 +591,99 @@ namespace cppstddb { namespace mysql {
 
         template<class P> struct field<P,std::string> {
             static std::string as(const rowset<P>& r, const cell_t<P>& cell) {
-                return static_cast<const char *>(cell.bind_.data);
+                return std::string(static_cast<const char *>(r.data(cell)), r.length(cell));
+            }
+        };
+
+        template<class P> struct field<P,string_view> {
+            static string_view as(const rowset<P>& r, const cell_t<P>& cell) {
+                return string_view(static_cast<const char *>(r.data(cell)), r.length(cell));
             }
         };
 
         template<class P> struct field<P,int> {
             static int as(const rowset<P>& r, const cell_t<P>& cell) {
-                return *static_cast<int*>(cell.bind_.data);
+                return *static_cast<const int*>(r.data(cell));
             }
         };
 
         template<class P> struct field<P,date_t> {
             static date_t as(const rowset<P>& r, const cell_t<P>& cell) {
-                auto& t = *static_cast<MYSQL_TIME*>(cell.bind_.data);
+                auto& t = *static_cast<const MYSQL_TIME*>(r.data(cell));
                 return date_t(t.year, t.month, t.day);
             }
         };
 
+        // input parameter binding (see statement::query(args...))
+
+        template<class P, typename T> struct param {};
+
+        template<class P> struct param<P,int> {
+            static void bind(MYSQL_BIND& b, MYSQL_TIME&, const int& v) {
+                b.buffer_type = MYSQL_TYPE_LONG;
+                b.buffer = const_cast<int*>(&v);
+            }
+        };
+
+        template<class P> struct param<P,int64_t> {
+            static void bind(MYSQL_BIND& b, MYSQL_TIME&, const int64_t& v) {
+                b.buffer_type = MYSQL_TYPE_LONGLONG;
+                b.buffer = const_cast<int64_t*>(&v);
+            }
+        };
+
+        template<class P> struct param<P,double> {
+            static void bind(MYSQL_BIND& b, MYSQL_TIME&, const double& v) {
+                b.buffer_type = MYSQL_TYPE_DOUBLE;
+                b.buffer = const_cast<double*>(&v);
+            }
+        };
+
+        template<class P> struct param<P,const char*> {
+            static void bind(MYSQL_BIND& b, MYSQL_TIME&, const char* v) {
+                b.buffer_type = MYSQL_TYPE_STRING;
+                b.buffer = const_cast<char*>(v);
+                b.buffer_length = strlen(v);
+                b.length = &b.buffer_length;
+            }
+        };
+
+        template<class P> struct param<P,std::string> {
+            static void bind(MYSQL_BIND& b, MYSQL_TIME&, const std::string& v) {
+                b.buffer_type = MYSQL_TYPE_STRING;
+                b.buffer = const_cast<char*>(v.data());
+                b.buffer_length = v.size();
+                b.length = &b.buffer_length;
+            }
+        };
+
+        template<class P> struct param<P,string_view> {
+            static void bind(MYSQL_BIND& b, MYSQL_TIME&, const string_view& v) {
+                b.buffer_type = MYSQL_TYPE_STRING;
+                b.buffer = const_cast<char*>(v.data());
+                b.buffer_length = v.size();
+                b.length = &b.buffer_length;
+            }
+        };
+
+        template<class P> struct param<P,date_t> {
+            static void bind(MYSQL_BIND& b, MYSQL_TIME& t, const date_t& v) {
+                memset(&t, 0, sizeof(t));
+                t.year = v.year();
+                t.month = v.month();
+                t.day = v.day();
+                t.time_type = MYSQL_TIMESTAMP_DATE;
+                b.buffer_type = MYSQL_TYPE_DATE;
+                b.buffer = &t;
+            }
+        };
+
+        template<class P> struct param<P,std::nullptr_t> {
+            static void bind(MYSQL_BIND& b, MYSQL_TIME&, std::nullptr_t) {
+                b.buffer_type = MYSQL_TYPE_NULL;
+            }
+        };
+
     }
 
     using database = cppstddb::front::basic_database<impl::database<default_policy>>;
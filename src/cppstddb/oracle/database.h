@@ -11,6 +11,8 @@
 
 namespace cppstddb { namespace oracle {
 
+    static const log_category db_log_category = log_category::oracle;
+
     namespace impl {
 
         template<class P> class database;
@@ -95,6 +97,7 @@ namespace cppstddb { namespace oracle {
                 }
 
                 string date_column_type() const {return "date";}
+                static bool accepts(value_type column, value_type requested) {return column == requested;}
         };
 
         template<class P> class connection {
@@ -124,7 +127,9 @@ namespace cppstddb { namespace oracle {
                     check("OCIHandleAlloc(OCI_HTYPE_SVCCTX)", st);
 
                     std::ostringstream ss;
-                    ss << src.server << ":" << src.port << "/" << src.database;
+                    ss << src.server;
+                    if (src.port) ss << ":" << src.port;
+                    ss << "/" << src.database;
 
                     // attach to the server
                     st = OCIServerAttach(srvhp_, db.err_hndl_,
@@ -180,6 +185,17 @@ namespace cppstddb { namespace oracle {
                   auto st = OCITransRollback(svc_ctx, db.err_hndl_, OCI_DEFAULT);
                   check("OCITransRollback", st, db.err_hndl_);
                 }
+
+                // before the pool hands the connection out again: an open
+                // transaction is rolled back (the attribute is read locally)
+                bool reset() {
+                    boolean in_transaction = FALSE;
+                    auto st = OCIAttrGet(authp_, OCI_HTYPE_SESSION, &in_transaction, nullptr,
+                                         OCI_ATTR_TRANSACTION_IN_PROGRESS, db.err_hndl_);
+                    if (st != OCI_SUCCESS) return false;
+                    if (in_transaction) rollback();
+                    return true;
+                }
         };
 
         template<class P> class statement {
@@ -222,6 +238,10 @@ namespace cppstddb { namespace oracle {
                   return stmt_hndl_.get();
                 }
 
+                // rows are fetched per row_array_size block
+                void mode(fetch_mode) {}
+                void prefetch(size_t) {}
+
                 void prepare() {
                     DB_TRACE("prepare sql: " << sql);
                     auto st = OCIStmtPrepare(stmt_hndl_.get(), con_.db.err_hndl_, //errhp_.get(),
@@ -565,6 +585,10 @@ namespace cppstddb { namespace oracle {
                     return describes[idx].name;
                 }
 
+                bool is_null(const cell_t& cell) const {
+                    return false; // no indicator variables defined yet
+                }
+
         };
 
 
@@ -576,6 +600,13 @@ namespace cppstddb { namespace oracle {
             }
         };
 
+        template<class P> struct field<P,string_view> {
+            static string_view as(const rowset<P>& r, const cell_t<P>& cell) {
+                // SQLT_STR defines are nul terminated
+                return string_view(static_cast<const char *>(cell.bind_.data));
+            }
+        };
+
         template<class P> struct field<P,int> {
             static int as(const rowset<P>& r, const cell_t<P>& cell) {
                 return *static_cast<int*>(cell.bind_.data);
@@ -0,0 +1,264 @@
+#ifndef CPPSTDDB_PARALLEL_H
+#define CPPSTDDB_PARALLEL_H
+
+#include <cppstddb/log.h>
+#include <cppstddb/database_error.h>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <tuple>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <cstdint>
+
+/*
+   Partitioned parallel scans (see basic_database::parallel_query). A key
+   range is split into disjoint slices, which a fixed set of worker threads
+   (no more than the pool has connections) take in key order, each on its
+   own leased connection. The rows come back through bounded channels in
+   batches, so workers stay at most a few batches ahead of the consumer.
+   Taking slices in order means the slice the consumer waits for always
+   has a worker, however many slices there are.
+ */
+
+namespace cppstddb {
+
+    // a bounded queue between producer threads and one consumer
+    template<class T> class channel {
+        public:
+            using value_type = T;
+
+            channel(size_t capacity, size_t producers):
+                capacity_(capacity ? capacity : 1),
+                producers_(producers),
+                cancelled_(false) {}
+
+            // blocks while full; false once the consumer has gone
+            bool push(value_type v) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_full_.wait(lock, [this] {return cancelled_ || queue_.size() < capacity_;});
+                if (cancelled_) return false;
+                queue_.push_back(std::move(v));
+                not_empty_.notify_one();
+                return true;
+            }
+
+            // a producer is done, with its failure if any
+            void close(std::exception_ptr error = nullptr) {
+                std::lock_guard<std::mutex> guard(mutex_);
+                if (error && !error_) error_ = error;
+                if (producers_) --producers_;
+                not_empty_.notify_all();
+            }
+
+            // blocks while empty; false once every producer closed and the
+            // queue is drained. rethrows the first producer failure
+            bool pop(value_type& v) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_empty_.wait(lock, [this] {return error_ || !queue_.empty() || !producers_;});
+                if (error_) std::rethrow_exception(error_);
+                if (queue_.empty()) return false;
+                v = std::move(queue_.front());
+                queue_.pop_front();
+                not_full_.notify_one();
+                return true;
+            }
+
+            // consumer side: release blocked producers
+            void cancel() {
+                std::lock_guard<std::mutex> guard(mutex_);
+                cancelled_ = true;
+                queue_.clear();
+                not_full_.notify_all();
+            }
+
+        private:
+            size_t capacity_;
+            size_t producers_;
+            bool cancelled_;
+            std::exception_ptr error_;
+            std::deque<value_type> queue_;
+            std::mutex mutex_;
+            std::condition_variable not_full_;
+            std::condition_variable not_empty_;
+    };
+
+    // closed key slices [first, second] covering [lo, hi] (any int64 range,
+    // so no bound past hi is ever formed)
+    inline std::vector<std::pair<int64_t,int64_t>> key_slices(int64_t lo, int64_t hi, size_t partitions) {
+        std::vector<std::pair<int64_t,int64_t>> slices;
+        if (hi < lo) return slices;
+        uint64_t last = static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo); // keys - 1
+        uint64_t n = partitions ? partitions : 1;
+        if (n - 1 > last) n = last + 1;
+        // keys = step * n + extra, computed without forming keys itself
+        uint64_t step = last / n, extra = last % n + 1;
+        if (extra == n) {
+            ++step;
+            extra = 0;
+        }
+        uint64_t start = static_cast<uint64_t>(lo);
+        for(uint64_t i = 0; i != n; ++i) {
+            uint64_t len = step + (i < extra ? 1 : 0);
+            slices.emplace_back(static_cast<int64_t>(start), static_cast<int64_t>(start + (len - 1)));
+            start += len;
+        }
+        return slices;
+    }
+
+    // rows of a parallel scan as std::tuple<T...>: an input range fed by the
+    // workers. ordered: slice by slice in key order, otherwise as they arrive.
+    // dropping the range stops the workers
+    template<class DB, class... T> class parallel_rowset {
+        public:
+            using database_type = DB;
+            using tuple_type = std::tuple<T...>;
+            using batch_type = std::vector<tuple_type>;
+            using string = std::string;
+
+            static const size_t batch_rows = 256;
+            static const size_t queued_batches = 4; // per channel
+
+            class iterator {
+                public:
+                    typedef std::ptrdiff_t difference_type;
+                    typedef tuple_type value_type;
+                    typedef const tuple_type& reference;
+                    typedef const tuple_type* pointer;
+                    typedef std::input_iterator_tag iterator_category;
+
+                    iterator(parallel_rowset* rows):rows_(rows && !rows->empty() ? rows : nullptr) {}
+                    reference operator*() const {return rows_->front();}
+                    iterator& operator++() {
+                        rows_->pop_front();
+                        if (rows_->empty()) rows_ = nullptr;
+                        return *this;
+                    }
+                    bool operator==(const iterator& i) const {return rows_ == i.rows_;}
+                    bool operator!=(const iterator& i) const {return rows_ != i.rows_;}
+                private:
+                    parallel_rowset* rows_;
+            };
+
+            parallel_rowset(
+                    database_type db,
+                    const string& sql,
+                    const std::vector<std::pair<int64_t,int64_t>>& slices,
+                    bool ordered,
+                    size_t workers):
+                state_(std::make_shared<state>(db, sql, slices, ordered)) {
+                    state_->start(workers);
+                    advance();
+                }
+
+            bool empty() const {return state_->idx == state_->batch.size();}
+            const tuple_type& front() const {return state_->batch[state_->idx];}
+            void pop_front() {
+                if (++state_->idx == state_->batch.size()) advance();
+            }
+
+            iterator begin() {return iterator(this);}
+            iterator end() {return iterator(nullptr);}
+
+        private:
+            struct state {
+                database_type db;
+                string sql;
+                std::vector<std::pair<int64_t,int64_t>> slices;
+                std::vector<std::unique_ptr<channel<batch_type>>> channels; // one, or one per slice when ordered
+                std::vector<std::thread> workers;
+                std::atomic<size_t> next; // slice to take
+                std::atomic<size_t> live; // workers not yet finished
+                std::atomic<bool> stopping;
+                size_t current; // channel being read
+                batch_type batch;
+                size_t idx;
+
+                state(database_type db_, const string& sql_, const std::vector<std::pair<int64_t,int64_t>>& slices_, bool ordered):
+                    db(db_),
+                    sql(sql_),
+                    slices(slices_),
+                    next(0),
+                    live(0),
+                    stopping(false),
+                    current(0),
+                    idx(0) {
+                        // every slice closes its channel once
+                        size_t n = ordered ? slices.size() : 1;
+                        for(size_t i = 0; i != n; ++i) {
+                            channels.emplace_back(new channel<batch_type>(queued_batches, ordered ? 1 : slices.size()));
+                        }
+                    }
+
+                ~state() {
+                    stopping = true;
+                    for(auto& c : channels) c->cancel();
+                    for(auto& w : workers) w.join();
+                }
+
+                void start(size_t n) {
+                    if (n > slices.size()) n = slices.size();
+                    DB_DEBUG("parallel scan: " << slices.size() << " slices, " << n << " workers: " << sql);
+                    live = n;
+                    for(size_t i = 0; i != n; ++i) workers.emplace_back([this] {work();});
+                }
+
+                channel<batch_type>& out(size_t slice) {return *channels[channels.size() == 1 ? 0 : slice];}
+
+                // worker thread: slices in key order on one connection. a worker
+                // without a connection leaves the slices to the others; the last
+                // one out fails whatever nobody took
+                void work() {
+                    size_t i;
+                    std::exception_ptr error;
+                    try {
+                        auto con = db.read_connection();
+                        while ((i = next++) < slices.size() && !stopping) scan(con, i);
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    if (--live) return;
+                    while ((i = next++) < slices.size()) out(i).close(error);
+                }
+
+                template<class C> void scan(C& con, size_t i) {
+                    auto& slice = slices[i];
+                    auto& out = this->out(i);
+                    try {
+                        auto stmt = con.statement(sql);
+                        batch_type rows;
+                        rows.reserve(batch_rows);
+                        for(auto t : stmt.query(slice.first, slice.second).template rows<T...>(int(batch_rows))) {
+                            rows.push_back(std::move(t));
+                            if (rows.size() != batch_rows) continue;
+                            if (!out.push(std::move(rows))) return out.close();
+                            rows = batch_type();
+                            rows.reserve(batch_rows);
+                        }
+                        if (!rows.empty()) out.push(std::move(rows));
+                        out.close();
+                    } catch (...) {
+                        out.close(std::current_exception());
+                    }
+                }
+            };
+
+            std::shared_ptr<state> state_;
+
+            void advance() {
+                auto& s = *state_;
+                s.idx = 0;
+                s.batch.clear();
+                while (s.current != s.channels.size()) {
+                    if (s.channels[s.current]->pop(s.batch)) return;
+                    ++s.current; // that channel is finished
+                }
+            }
+    };
+
+}
+
+#endif
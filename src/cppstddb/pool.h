@@ -0,0 +1,275 @@
+#ifndef CPPSTDDB_POOL_H
+#define CPPSTDDB_POOL_H
+
+#include <cppstddb/log.h>
+#include <cppstddb/database_error.h>
+#include <memory>
+#include <functional>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/*
+   A sharded connection pool. Idle connections are kept in a few
+   independently locked shards so that concurrent checkout/return from
+   different threads rarely contend on the same mutex. Checked out
+   connections are handed out as shared_ptr leases which return the
+   connection to the pool when the last reference goes away. A returned
+   connection is reset first (see reset_type) and dropped if that fails.
+ */
+
+namespace cppstddb {
+
+    struct pool_options {
+        using duration = std::chrono::milliseconds;
+
+        size_t min_size = 0;         // opened up front, idle connections never reaped below this
+        size_t max_size = 16;        // upper bound on live connections
+        size_t shards = 4;
+        duration idle_timeout = std::chrono::seconds(60);
+        duration acquire_timeout = std::chrono::seconds(30);
+
+        // with readers > 0: a single writer connection plus up to readers read
+        // only connections, and queries are routed to the readers (see basic_database)
+        size_t readers = 0;
+    };
+
+    template<class T> class connection_pool :
+        public std::enable_shared_from_this<connection_pool<T>> {
+            public:
+                using value_type = T;
+                using factory_type = std::function<std::unique_ptr<value_type>()>;
+                using reset_type = std::function<bool(value_type&)>; // false: drop the connection
+                using lease_type = std::shared_ptr<value_type>;
+                using clock = std::chrono::steady_clock;
+
+                static const log_category db_log_category = log_category::pool;
+
+                connection_pool(factory_type factory, const pool_options& options, reset_type reset = nullptr):
+                    factory_(std::move(factory)),
+                    reset_(std::move(reset)),
+                    options_(options),
+                    shards_(options.shards ? options.shards : 1),
+                    size_(0),
+                    waiters_(0),
+                    last_reap_(clock::now().time_since_epoch().count()),
+                    holder_(std::thread::id()) {
+                        if (options_.max_size == 0) options_.max_size = 1;
+                        if (options_.min_size > options_.max_size) options_.min_size = options_.max_size;
+                        try {
+                            for(size_t n = 0; n != options_.min_size; ++n) {
+                                ++size_;
+                                auto ptr = create();
+                                shards_[n % shards_.size()].idle.push_back(entry{ptr, clock::now()});
+                            }
+                        } catch (...) {
+                            close_idle();
+                            throw;
+                        }
+                    }
+
+                ~connection_pool() {
+                    DB_TRACE("~pool: size: " << size_);
+                    close_idle();
+                }
+
+                connection_pool(const connection_pool&) = delete;
+                connection_pool& operator=(const connection_pool&) = delete;
+
+                const pool_options& options() const {return options_;}
+
+                // total live connections, idle and checked out
+                size_t size() const {return size_;}
+
+                size_t idle() const {
+                    size_t n = 0;
+                    for(auto& s : shards_) {
+                        guard_t guard(s.mutex);
+                        n += s.idle.size();
+                    }
+                    return n;
+                }
+
+                // with a single connection (the writer beside readers), a second
+                // lease on the thread that holds it would wait for itself: that
+                // fails at once instead of after acquire_timeout
+                lease_type acquire() {
+                    auto ptr = checkout();
+                    if (options_.max_size == 1) holder_ = std::this_thread::get_id();
+                    std::weak_ptr<connection_pool> pool = this->shared_from_this();
+                    return lease_type(ptr, [pool](value_type* p) {
+                        if (auto sp = pool.lock()) sp->release(p); else delete p;
+                    });
+                }
+
+                // close idle connections unused for longer than idle_timeout,
+                // keeping at least min_size alive
+                void reap() {
+                    auto now = clock::now();
+                    last_reap_ = now.time_since_epoch().count();
+                    std::vector<value_type*> closing;
+                    for(auto& s : shards_) {
+                        guard_t guard(s.mutex);
+                        auto i = s.idle.begin();
+                        while (i != s.idle.end()) {
+                            if (now - i->last_used < options_.idle_timeout || !try_shrink()) {
+                                ++i;
+                                continue;
+                            }
+                            closing.push_back(i->ptr);
+                            i = s.idle.erase(i);
+                        }
+                    }
+                    if (!closing.empty()) DB_DEBUG("pool: reaping " << closing.size() << " idle connections");
+                    for(auto p : closing) delete p;
+                }
+
+            private:
+                using guard_t = std::lock_guard<std::mutex>;
+
+                struct entry {
+                    value_type* ptr;
+                    clock::time_point last_used;
+                };
+
+                struct alignas(64) shard {
+                    mutable std::mutex mutex;
+                    std::vector<entry> idle;
+                };
+
+                factory_type factory_;
+                reset_type reset_;
+                pool_options options_;
+                std::vector<shard> shards_;
+                std::atomic<size_t> size_;
+                std::atomic<size_t> waiters_;
+                std::atomic<clock::rep> last_reap_;
+                std::atomic<std::thread::id> holder_; // of the only connection, when max_size is 1
+                std::mutex wait_mutex_;
+                std::condition_variable available_;
+
+                shard& home_shard() {
+                    auto h = std::hash<std::thread::id>()(std::this_thread::get_id());
+                    return shards_[h % shards_.size()];
+                }
+
+                value_type* try_pop() {
+                    // home shard first (most recently used = warmest), then steal
+                    auto& home = home_shard();
+                    auto start = &home - &shards_[0];
+                    for(size_t n = 0; n != shards_.size(); ++n) {
+                        auto& s = shards_[(start + n) % shards_.size()];
+                        guard_t guard(s.mutex);
+                        if (s.idle.empty()) continue;
+                        auto ptr = s.idle.back().ptr;
+                        s.idle.pop_back();
+                        return ptr;
+                    }
+                    return nullptr;
+                }
+
+                bool try_grow() {
+                    auto n = size_.load();
+                    while (n < options_.max_size) {
+                        if (size_.compare_exchange_weak(n, n + 1)) return true;
+                    }
+                    return false;
+                }
+
+                bool try_shrink() {
+                    auto n = size_.load();
+                    while (n > options_.min_size) {
+                        if (size_.compare_exchange_weak(n, n - 1)) return true;
+                    }
+                    return false;
+                }
+
+                value_type* create() {
+                    try {
+                        auto p = factory_();
+                        DB_DEBUG("pool: new connection, size: " << size_);
+                        return p.release();
+                    } catch (...) {
+                        --size_;
+                        notify();
+                        throw;
+                    }
+                }
+
+                value_type* checkout() {
+                    if (auto p = try_pop()) return p;
+                    if (try_grow()) return create();
+                    if (options_.max_size == 1 && holder_ == std::this_thread::get_id()) {
+                        throw database_error("connection pool: this thread already holds the only connection");
+                    }
+
+                    auto deadline = clock::now() + options_.acquire_timeout;
+                    std::unique_lock<std::mutex> lock(wait_mutex_);
+                    ++waiters_;
+                    for(;;) {
+                        if (auto p = try_pop()) {--waiters_; return p;}
+                        if (try_grow()) {
+                            --waiters_;
+                            lock.unlock();
+                            return create();
+                        }
+                        if (available_.wait_until(lock, deadline) == std::cv_status::timeout) {
+                            if (auto p = try_pop()) {--waiters_; return p;}
+                            --waiters_;
+                            throw database_error("connection pool: acquire timeout");
+                        }
+                    }
+                }
+
+                void close_idle() {
+                    for(auto& s : shards_) {
+                        for(auto& e : s.idle) delete e.ptr;
+                        s.idle.clear();
+                    }
+                }
+
+                // the next lease must not see this one's transaction or results
+                bool reusable(value_type& con) {
+                    if (!reset_) return true;
+                    try {
+                        return reset_(con);
+                    } catch (const std::exception& e) {
+                        DB_WARN("pool: reset failed: " << e.what());
+                        return false;
+                    }
+                }
+
+                void release(value_type* ptr) {
+                    if (options_.max_size == 1) holder_ = std::thread::id();
+                    if (!reusable(*ptr)) {
+                        DB_DEBUG("pool: dropping connection, size: " << size_);
+                        --size_;
+                        delete ptr;
+                        notify();
+                        return;
+                    }
+                    auto now = clock::now();
+                    {
+                        auto& s = home_shard();
+                        guard_t guard(s.mutex);
+                        s.idle.push_back(entry{ptr, now});
+                    }
+                    notify();
+
+                    auto idle_ticks = std::chrono::duration_cast<clock::duration>(options_.idle_timeout).count();
+                    if (now.time_since_epoch().count() - last_reap_ > idle_ticks) reap();
+                }
+
+                void notify() {
+                    if (!waiters_) return;
+                    guard_t guard(wait_mutex_);
+                    available_.notify_one();
+                }
+        };
+
+}
+
+#endif
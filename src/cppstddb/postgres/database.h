@@ -4,7 +4,13 @@
 #include <cppstddb/front.h>
 #include <cppstddb/util.h>
 #include <cppstddb/endian.h>
+#include <cppstddb/statement_cache.h>
+#include <cppstddb/reactor.h>
+#include <cppstddb/metadata_cache.h>
 #include <vector>
+#include <deque>
+#include <tuple>
+#include <algorithm>
 #include <libpq-fe.h>
 #include <pgtypes_date.h>
 #include <cstring>
@@ -28,12 +34,16 @@ static const int TIDOID = 27;
 static const int XIDOID = 28;
 static const int CIDOID = 29;
 static const int OIDVECTOROID = 30;
+static const int FLOAT8OID = 701;
+static const int BPCHAROID = 1042;
 static const int VARCHAROID = 1043;
 static const int DATEOID = 1082;
 
 
 namespace cppstddb { namespace postgres {
 
+	static const log_category db_log_category = log_category::postgres;
+
 	namespace impl {
 
 		template<class P> class database;
@@ -42,6 +52,7 @@ namespace cppstddb { namespace postgres {
 		template<class P> class rowset;
 		template<class P> class bind_type;
 		template<class P,class T> class field;
+		template<class P,class T> struct param;
 
 		template<class P> using cell_t = cppstddb::front::cell<database<P>>;
 
@@ -59,6 +70,67 @@ namespace cppstddb { namespace postgres {
 			throw database_error(s);
 		}
 
+		// fixed size staging buffer for COPY data: full buffers are handed
+		// to PQputCopyData, so memory stays flat however many rows are sent
+		class copy_buffer {
+			public:
+				static const size_t capacity = 64 * 1024;
+
+				copy_buffer(PGconn* con):con_(con),size_(0),data_(new char[capacity]) {}
+
+				void put(const void* p, size_t n) {
+					if (size_ + n > capacity) {
+						flush();
+						if (n > capacity) return send(static_cast<const char*>(p), n);
+					}
+					memcpy(&data_[size_], p, n);
+					size_ += n;
+				}
+
+				void put2(int16_t v) {char b[2]; native_to_big2(v, b); put(b, 2);}
+				void put4(int32_t v) {char b[4]; native_to_big4(v, b); put(b, 4);}
+
+				void flush() {
+					if (size_) send(&data_[0], size_);
+					size_ = 0;
+				}
+
+			private:
+				PGconn* con_;
+				size_t size_;
+				std::unique_ptr<char[]> data_;
+
+				void send(const char* p, size_t n) {
+					if (PQputCopyData(con_, p, static_cast<int>(n)) != 1) raise_error(con_, "PQputCopyData");
+				}
+		};
+
+		// column decoders for copy_out: binary COPY field -> column buffer
+
+		template<class T> struct copy_column {};
+
+		template<> struct copy_column<int> {
+			static const column_type type = column_type::int32;
+			static void append(column_buffer& col, const char* p, int len) {
+				if (len != 4) raise_error("copy_out: int column is not int4");
+				col.append(big4_to_native(p));
+			}
+		};
+
+		template<> struct copy_column<std::string> {
+			static const column_type type = column_type::utf8;
+			static void append(column_buffer& col, const char* p, int len) {col.append(p, len);}
+		};
+
+		template<> struct copy_column<date_t> {
+			static const column_type type = column_type::date32;
+			static void append(column_buffer& col, const char* p, int len) {
+				if (len != 4) raise_error("copy_out: date column is not a date");
+				const int epoch_2000 = 10957; // postgres dates count days from 2000-01-01
+				col.append(big4_to_native(p) + epoch_2000);
+			}
+		};
+
 		template<class P> class database {
 			public:
 				using policy_type = P;
@@ -78,6 +150,8 @@ namespace cppstddb { namespace postgres {
 				}
 
 				string date_column_type() const {return "date";}
+				string placeholder(int n) const {return "$" + std::to_string(n);}
+				static bool accepts(value_type column, value_type requested) {return column == requested;}
 		};
 
 		template<class P> class connection {
@@ -85,28 +159,434 @@ namespace cppstddb { namespace postgres {
 				using policy_type = P;
 				using string = typename policy_type::string;
 				using database = database<policy_type>;
+				using statement_cache = statement_cache<string>;
 
 
+				using statement = statement<policy_type>;
+
+				// a command sent in pipeline mode whose result is still to be read
+				struct pending_type {
+					statement* owner; // null once the statement is gone
+					bool prepare;
+					string key;
+				};
+
 				database& db;
 				PGconn *con;
-
-				connection(database& db_, const source& src):db(db_) {
+				statement_cache statements; // prepared statement names by sql
+				int statement_id;
+				bool closing;
+				bool pipelined;
+				bool broken; // protocol state unknown (pipeline mode not left): not reusable
+				std::deque<pending_type> pending;
+				std::vector<string> deferred; // deallocations held back while pipelined
+				string metadata_prefix; // names the database in metadata cache keys
+
+				connection(database& db_, const source& src):
+					db(db_),
+					statements([this](const string& name) {deallocate(name);}),
+					statement_id(0),
+					closing(false),
+					pipelined(false),
+					broken(false) {
 					DB_TRACE("con, source: " << src);
 
+					// unset keys fall back to libpq's defaults (PGHOST, PGPORT, ...)
 					string conninfo;
-					conninfo += "host=";
-					conninfo += src.server;
-					conninfo += " dbname=";
-					conninfo += src.database;
+					add_conninfo(conninfo, "host", src.server); // a directory for unix sockets
+					if (src.port) add_conninfo(conninfo, "port", std::to_string(src.port));
+					add_conninfo(conninfo, "dbname", src.database);
+					metadata_prefix = conninfo + "\n"; // without credentials
 					DB_TRACE("conninfo:" << conninfo);
+					add_conninfo(conninfo, "user", src.username);
+					add_conninfo(conninfo, "password", src.password);
+					for(auto& o : src.options) add_conninfo(conninfo, o.first.c_str(), o.second);
 					con = PQconnectdb(conninfo.c_str());
 					if (PQstatus(con) != CONNECTION_OK) raise_error(con, "login error");
 				}
 
+				// key='value' with ' and \ escaped (libpq conninfo rules), when set
+				static void add_conninfo(string& conninfo, const char* key, const string& value) {
+					if (value.empty()) return;
+					if (!conninfo.empty()) conninfo += ' ';
+					conninfo += key;
+					conninfo += "='";
+					for(auto c : value) {
+						if (c == '\'' || c == '\\') conninfo += '\\';
+						conninfo += c;
+					}
+					conninfo += '\'';
+				}
+
 				~connection() {
 					DB_TRACE("~con");
+					closing = true; // server drops prepared statements with the session
+					statements.clear();
 					PQfinish(con);
 				}
+
+				void begin() {exec("begin");}
+				void commit() {exec("commit");}
+				void rollback() {exec("rollback");}
+
+				void exec(const char* sql) {
+					DB_TRACE(sql);
+					auto r = PQexec(con, sql);
+					auto status = PQresultStatus(r);
+					PQclear(r);
+					if (is_ddl(sql)) bump_schema_epoch();
+					if (status != PGRES_COMMAND_OK) raise_error(con, sql);
+				}
+
+				// before the pool hands the connection out again: no transaction and
+				// no results left to read. false when the connection is unusable
+				bool reset() {
+					if (broken || PQstatus(con) != CONNECTION_OK || pipelined || PQpipelineStatus(con) != PQ_PIPELINE_OFF) return false;
+					if (PQtransactionStatus(con) == PQTRANS_ACTIVE) {
+						// a result abandoned mid stream: cancel it and read to the end
+						cancel();
+						while (auto r = PQgetResult(con)) {
+							auto status = PQresultStatus(r);
+							PQclear(r);
+							if (status == PGRES_COPY_IN || status == PGRES_COPY_OUT || status == PGRES_COPY_BOTH) return false;
+						}
+					}
+					switch (PQtransactionStatus(con)) {
+						case PQTRANS_IDLE:
+							return true;
+						case PQTRANS_INTRANS:
+						case PQTRANS_INERROR: {
+							DB_DEBUG("reset: rolling back open transaction");
+							rollback();
+							return true;
+						}
+						default:
+							return false;
+					}
+				}
+
+				// ask the server to stop the running command (its results still
+				// have to be read: they end early, with an error)
+				void cancel() {
+					if (auto cancel = PQgetCancel(con)) {
+						char error[256];
+						if (!PQcancel(cancel, error, sizeof(error))) DB_WARN("PQcancel: " << error);
+						PQfreeCancel(cancel);
+					}
+				}
+
+				string next_statement_name() {
+					return "cppstddb_" + std::to_string(++statement_id);
+				}
+
+				void deallocate(const string& name) {
+					if (closing) return;
+					if (pipelined) {
+						deferred.push_back(name);
+						return;
+					}
+					DB_TRACE("deallocate: " << name);
+					PQclear(PQexec(con, ("deallocate " + name).c_str()));
+				}
+
+				// pipeline mode: commands are sent back to back and their results
+				// read in order by sync()
+
+				void enter_pipeline() {
+					if (pipelined) raise_error("already in pipeline mode");
+					if (broken) raise_error("connection left in pipeline mode");
+					if (PQenterPipelineMode(con) != 1) raise_error(con, "PQenterPipelineMode");
+					pipelined = true;
+				}
+
+				void exit_pipeline() {
+					if (!pipelined) return;
+					try {
+						sync();
+					} catch (...) {
+						try {
+							leave_pipeline();
+						} catch (const std::exception& e) {
+							DB_WARN("exit_pipeline: " << e.what()); // the sync failure is the one to report
+						}
+						throw;
+					}
+					leave_pipeline();
+				}
+
+				void queue(statement* owner, bool prepare, const string& key) {
+					pending.push_back(pending_type{owner, prepare, key});
+				}
+
+				void abandon(statement* owner) {
+					for(auto& p : pending) if (p.owner == owner) p.owner = nullptr;
+				}
+
+				// send a sync point and distribute all pending results to their statements
+				void sync() {
+					if (pending.empty()) return;
+					DB_TRACE("pipeline sync: " << pending.size() << " results");
+					if (PQpipelineSync(con) != 1) raise_error(con, "PQpipelineSync");
+
+					string error;
+					while (!pending.empty()) {
+						auto p = pending.front();
+						pending.pop_front();
+						auto r = PQgetResult(con);
+						while (auto extra = PQgetResult(con)) PQclear(extra); // up to the command end
+						auto status = PQresultStatus(r);
+						auto ok = status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK || status == PGRES_EMPTY_QUERY;
+						if (!ok && error.empty() && status != PGRES_PIPELINE_ABORTED) error = PQresultErrorMessage(r);
+						if (p.prepare) {
+							PQclear(r);
+							if (ok) continue;
+							// don't leave a failed statement name behind
+							if (p.owner) p.owner->prepared = false; else {string name; statements.take(p.key, name);}
+						} else if (p.owner) {
+							p.owner->resolve(r);
+						} else {
+							PQclear(r);
+						}
+					}
+
+					auto r = PQgetResult(con);
+					auto status = PQresultStatus(r);
+					PQclear(r);
+					if (status != PGRES_PIPELINE_SYNC) {
+						// out of step: read through to the sync point so that
+						// pipeline mode can still be left
+						if (!drain_to_sync()) broken = true;
+						raise_error("pipeline: expected sync result");
+					}
+					if (!error.empty()) raise_error("pipeline: " + error);
+				}
+
+				// discard results up to and including the next sync point;
+				// false when there is none to read
+				bool drain_to_sync() {
+					for(int empty = 0; empty != 2;) {
+						auto r = PQgetResult(con);
+						if (!r) {
+							++empty; // one null ends a command, two: nothing more queued
+							continue;
+						}
+						empty = 0;
+						auto status = PQresultStatus(r);
+						PQclear(r);
+						if (status == PGRES_PIPELINE_SYNC) return true;
+					}
+					return false;
+				}
+
+				// a name quoted for sql text (exact case)
+				string quote_identifier(const string& name) {
+					auto q = PQescapeIdentifier(con, name.c_str(), name.size());
+					if (!q) raise_error(con, "PQescapeIdentifier");
+					string quoted = q;
+					PQfreemem(q);
+					return quoted;
+				}
+
+				// schema.table is quoted per part
+				string quote_table(const string& name) {
+					auto dot = name.find('.');
+					if (dot == string::npos) return quote_identifier(name);
+					return quote_identifier(name.substr(0, dot)) + "." + quote_identifier(name.substr(dot + 1));
+				}
+
+				// bulk load with COPY ... FROM STDIN (FORMAT binary). each element
+				// of range is a tuple with one value per column, encoded like the
+				// statement parameters. table and column names are quoted, so they
+				// match exactly as written. returns the number of rows loaded
+				template<class R> size_t copy_in(const string& table, const std::vector<string>& columns, const R& range) {
+					string sql = "copy " + quote_table(table);
+					if (!columns.empty()) {
+						sql += " (";
+						for(size_t i = 0; i != columns.size(); ++i) {
+							if (i) sql += ",";
+							sql += quote_identifier(columns[i]);
+						}
+						sql += ")";
+					}
+					sql += " from stdin (format binary)";
+					DB_TRACE("copy_in: " << sql);
+
+					auto r = PQexec(con, sql.c_str());
+					auto status = PQresultStatus(r);
+					PQclear(r);
+					if (status != PGRES_COPY_IN) raise_error(con, "copy_in");
+
+					copy_buffer buf(con);
+					try {
+						static const char signature[] = "PGCOPY\n\377\r\n";
+						buf.put(signature, 11);
+						buf.put4(0); // flags
+						buf.put4(0); // header extension length
+						for(auto& row : range) put_row(buf, row);
+						buf.put2(-1); // trailer
+						buf.flush();
+					} catch (...) {
+						PQputCopyEnd(con, "copy_in aborted");
+						while (auto extra = PQgetResult(con)) PQclear(extra);
+						throw;
+					}
+					if (PQputCopyEnd(con, nullptr) != 1) raise_error(con, "PQputCopyEnd");
+
+					size_t count = 0;
+					string error;
+					while (auto extra = PQgetResult(con)) {
+						if (PQresultStatus(extra) == PGRES_COMMAND_OK) {
+							count = std::stoul("0" + string(PQcmdTuples(extra)));
+						} else if (error.empty()) {
+							error = PQresultErrorMessage(extra);
+						}
+						PQclear(extra);
+					}
+					if (!error.empty()) raise_error("copy_in: " + error);
+					return count;
+				}
+
+				// bulk export with COPY (query) TO STDOUT (FORMAT binary). the stream
+				// is decoded row by row straight into column buffers (no PGresult);
+				// fn gets each batch of up to batch_rows rows. T... are the column types
+				template<class... T, class F> void copy_out(const string& query, size_t batch_rows, F fn) {
+					auto names = column_names(query);
+					if (names.size() != sizeof...(T)) raise_error("copy_out: column count mismatch");
+
+					string sql = "copy (" + query + ") to stdout (format binary)";
+					DB_TRACE("copy_out: " << sql);
+
+					auto r = PQexec(con, sql.c_str());
+					auto status = PQresultStatus(r);
+					PQclear(r);
+					if (status != PGRES_COPY_OUT) raise_error(con, "copy_out");
+
+					const column_type types[] = {copy_column<T>::type...};
+					auto make_batch = [&] {
+						column_batch batch;
+						for(size_t i = 0; i != sizeof...(T); ++i) {
+							batch.add_column(names[i], types[i]).reserve(batch_rows);
+						}
+						return batch;
+					};
+
+					auto batch = make_batch();
+					bool header = true;
+					char* buf = nullptr;
+					int n;
+					try {
+						while ((n = PQgetCopyData(con, &buf, 0)) > 0) {
+							const char* p = buf;
+							const char* end = buf + n;
+							if (header) {
+								// signature, flags, extension area
+								if (n < 19 || memcmp(p, "PGCOPY\n\377\r\n", 11)) raise_error("copy_out: bad header");
+								p += 15;
+								p += 4 + big4_to_native(p);
+								header = false;
+							}
+							auto fields = end - p >= 2 ? read2(p) : -1; // -1: trailer
+							if (fields != -1) {
+								if (fields != sizeof...(T)) raise_error("copy_out: column count mismatch");
+								decode_row<T...>(batch, p, end, std::index_sequence_for<T...>());
+								if (size_t(batch.length()) == batch_rows) {
+									fn(batch);
+									batch = make_batch();
+								}
+							}
+							PQfreemem(buf);
+							buf = nullptr;
+						}
+					} catch (...) {
+						PQfreemem(buf);
+						cancel(); // then read what is already in flight
+						while (PQgetCopyData(con, &buf, 0) > 0) PQfreemem(buf);
+						while (auto extra = PQgetResult(con)) PQclear(extra);
+						throw;
+					}
+					if (n == -2) raise_error(con, "PQgetCopyData");
+
+					string error;
+					while (auto extra = PQgetResult(con)) {
+						if (PQresultStatus(extra) != PGRES_COMMAND_OK && error.empty()) error = PQresultErrorMessage(extra);
+						PQclear(extra);
+					}
+					if (!error.empty()) raise_error("copy_out: " + error);
+					if (!batch.empty()) fn(batch);
+				}
+
+				// result column names of a query, from a describe of it (unnamed statement)
+				std::vector<string> column_names(const string& query) {
+					auto r = PQprepare(con, "", query.c_str(), 0, nullptr);
+					auto status = PQresultStatus(r);
+					PQclear(r);
+					if (status != PGRES_COMMAND_OK) raise_error(con, "copy_out: prepare");
+					r = PQdescribePrepared(con, "");
+					if (PQresultStatus(r) != PGRES_COMMAND_OK) {
+						PQclear(r);
+						raise_error(con, "copy_out: describe");
+					}
+					std::vector<string> names;
+					for(int i = 0; i != PQnfields(r); ++i) names.push_back(PQfname(r, i));
+					PQclear(r);
+					return names;
+				}
+
+			private:
+				static int16_t read2(const char*& p) {
+					auto a = reinterpret_cast<const unsigned char*>(p);
+					p += 2;
+					return static_cast<int16_t>((a[0] << 8) | a[1]);
+				}
+
+				template<class... T, size_t... I> static void decode_row(column_batch& batch, const char*& p, const char* end, std::index_sequence<I...>) {
+					int expand[] = {0, (decode_field<T>(batch[I], p, end), 0)...};
+					(void) expand;
+				}
+
+				template<class T> static void decode_field(column_buffer& col, const char*& p, const char* end) {
+					if (end - p < 4) raise_error("copy_out: truncated row");
+					int len = big4_to_native(p);
+					p += 4;
+					if (len < 0) return col.append_null();
+					if (end - p < len) raise_error("copy_out: truncated field");
+					copy_column<T>::append(col, p, len);
+					p += len;
+				}
+
+				template<class... T> static void put_row(copy_buffer& buf, const std::tuple<T...>& row) {
+					buf.put2(sizeof...(T));
+					put_fields(buf, row, std::index_sequence_for<T...>());
+				}
+
+				template<class... T, size_t... I> static void put_fields(copy_buffer& buf, const std::tuple<T...>& row, std::index_sequence<I...>) {
+					int expand[] = {0, (put_field(buf, std::get<I>(row)), 0)...};
+					(void) expand;
+				}
+
+				template<class T> static void put_field(copy_buffer& buf, const T& v) {
+					using param_type = param<policy_type,std::decay_t<const T>>;
+					char scratch[8];
+					auto n = param_type::length(v);
+					buf.put4(n);
+					buf.put(param_type::value(v, scratch), n);
+				}
+
+				static void put_field(copy_buffer& buf, std::nullptr_t) {
+					buf.put4(-1);
+				}
+
+				void leave_pipeline() {
+					pending.clear();
+					pipelined = false;
+					if (PQexitPipelineMode(con) != 1) {
+						broken = true; // still in pipeline mode: the pool drops the connection
+						raise_error(con, "PQexitPipelineMode");
+					}
+					auto names = std::move(deferred);
+					deferred.clear();
+					for(auto& n : names) deallocate(n);
+				}
 		};
 
 		template<class P> class statement {
@@ -117,52 +597,389 @@ namespace cppstddb { namespace postgres {
 				using rowset = rowset<policy_type>;
 
 				//private:
+				connection& c;
 				PGconn *con;
-				PGresult *prepare_res;
 				PGresult *res;
 				string sql_;
 				string name;
-
-				std::vector<char*> bindValue;
-				std::vector<Oid> bindtype;
+				string key; // cache key: sql plus parameter types
+				std::vector<Oid> param_types; // what the server side statement was prepared for
+				bool prepared;
+				bool ddl; // cached result metadata may be stale once it ran
+				bool queued; // result pending in pipeline mode
+				bool sending; // async execution in progress
+				bool preparing; // async: the prepare is in flight, the query follows it
+				fetch_mode mode_;
+				bool streaming; // rows still arriving for the current result
+				int chunk_rows;
+
+				std::vector<const char*> bindValue;
 				std::vector<int> bindLength;
 				std::vector<int> bindFormat;
+				std::vector<char> bindData; // binary encoding of fixed size params
 			public:
 
-				statement(connection& c, const string& sql):con(c.con), sql_(sql) {
+				statement(connection& c_, const string& sql):
+					c(c_),
+					con(c_.con),
+					res(nullptr),
+					sql_(sql),
+					prepared(false),
+					ddl(is_ddl(sql)),
+					queued(false),
+					sending(false),
+					preparing(false),
+					mode_(fetch_mode::driver_default),
+					streaming(false),
+					chunk_rows(default_chunk_rows) {
 					DB_TRACE("stmt: " << sql);
 				}
 
 				~statement() {
 					DB_TRACE("~stmt");
+					if (queued) c.abandon(this);
+					if (streaming) end_stream();
+					PQclear(res);
+					// keep the server side statement for reuse on this connection
+					if (prepared) c.statements.put(key, name);
 				}
 
+				static const int default_chunk_rows = 256;
+
+				// streaming: rows arrive in small results (chunked rows mode where
+				// libpq has it, else single row mode) instead of one buffered result.
+				// cursor is treated as streaming (no protocol level cursors in libpq)
+				void mode(fetch_mode m) {mode_ = m;}
+
+				// rows per chunk in chunked rows mode
+				void prefetch(size_t rows) {chunk_rows = rows ? rows : 1;}
+
 				statement& query() {
-					if (!prepare_res) prepare();
+					if (streaming) end_stream();
+					bind_params();
+					execute();
+					if (ddl) bump_schema_epoch();
+					return *this;
+				}
+
+				template<typename... Args> statement& query(const Args&... args) {
+					if (streaming) end_stream();
+					bind_params(args...);
+					execute();
+					if (ddl) bump_schema_epoch();
+					return *this;
+				}
+
+#ifdef CPPSTDDB_REACTOR
+				// non-blocking execution driven by the shared reactor; done is
+				// called on a reactor thread with nullptr or the failure. a first
+				// time prepare is sent ahead of the query the same way
+				template<typename... Args> void async_query(std::function<void(std::exception_ptr)> done, const Args&... args) {
+					if (c.pipelined) raise_error("async_query: connection is in pipeline mode");
+					if (streaming) end_stream();
+					sending = true;
+					try {
+						bind_params(args...);
+						send(std::move(done));
+					} catch (...) {
+						if (preparing) prepared = false;
+						sending = preparing = false;
+						throw;
+					}
+				}
+#else
+				// no reactor on this platform: runs synchronously, done is called inline
+				template<typename... Args> void async_query(std::function<void(std::exception_ptr)> done, const Args&... args) {
+					try {
+						query(args...);
+					} catch (...) {
+						return done(std::current_exception());
+					}
+					done(nullptr);
+				}
+#endif
+
+				void prepare()  {
+					// deferred to the first execution, where the parameter types are known
+				}
+
+				void prepare(int n, const Oid* types) {
+					param_types.assign(types, types + n);
+					key = sql_;
+					for(int i = 0; i != n; ++i) {
+						key += ':';
+						key += std::to_string(types[i]);
+					}
+					if (!c.statements.take(key, name)) {
+						name = c.next_statement_name();
+						DB_TRACE("prepare: " << name << ": " << sql_);
+						if (c.pipelined) {
+							if (!PQsendPrepare(con, name.c_str(), sql_.c_str(), n, types)) raise_error(con, "PQsendPrepare");
+							c.queue(this, true, key);
+							prepared = true;
+							return;
+						}
+						if (sending) {
+							preparing = true; // sent by send()
+							prepared = true;
+							return;
+						}
+						auto r = PQprepare(
+								con,
+								name.c_str(),
+								sql_.c_str(),
+								n,
+								types);
+						auto status = PQresultStatus(r);
+						PQclear(r);
+						if (status != PGRES_COMMAND_OK) raise_error(con, "PQprepare");
+					}
+					prepared = true;
+				}
+
+				// the result, waiting for the pipeline if it is still pending
+				PGresult* result() {
+					if (queued) c.sync();
+					return res;
+				}
+
+				// streaming: replace the current result with the next chunk,
+				// or null at the end of the rows
+				PGresult* next_result() {
+					PQclear(res);
+					res = nullptr;
+					if (!streaming) return nullptr;
+					res = PQgetResult(con);
+					switch(PQresultStatus(res)) {
+						case PGRES_SINGLE_TUPLE:
+#ifdef LIBPQ_HAS_CHUNK_MODE
+						case PGRES_TUPLES_CHUNK:
+#endif
+							return res;
+						case PGRES_TUPLES_OK: // zero row terminator
+							drain();
+							PQclear(res);
+							res = nullptr;
+							return nullptr;
+						default: {
+							string msg = PQresultErrorMessage(res);
+							drain();
+							raise_error("streaming: " + msg);
+						}
+					}
+					return nullptr;
+				}
+
+				// abandon a stream: cancel on the server and discard what is in flight
+				void end_stream() {
+					DB_DEBUG("stmt: cancelling stream");
+					c.cancel();
+					drain();
+				}
+
+				void resolve(PGresult* r) {
+					PQclear(res);
+					res = r;
+					queued = false;
+				}
+
+				void check_result(const char* msg) {
+					switch(PQresultStatus(res)) {
+						case PGRES_COMMAND_OK:
+						case PGRES_TUPLES_OK:
+						case PGRES_EMPTY_QUERY:
+							return;
+						default:
+							raise_error(con, msg);
+					}
+				}
+
+			private:
+				using done_type = std::function<void(std::exception_ptr)>;
+
+				template<typename... Args> void bind_params(const Args&... args) {
+					const Oid types[] = {param<policy_type,std::decay_t<const Args>>::oid..., 0};
+					auto n = sizeof...(Args);
+					// a later query(args...) may bind other types: switch to the
+					// statement prepared for those, keeping this one in the cache
+					if (prepared && !std::equal(types, types + n, param_types.begin(), param_types.end())) {
+						c.statements.put(key, name);
+						prepared = false;
+					}
+					if (!prepared) prepare(n, types);
+					bindValue.resize(n);
+					bindLength.resize(n);
+					bindFormat.assign(n, 1);
+					bindData.resize(8 * n);
+					bind(0, args...);
+				}
+
+				void drain() {
+					while (auto r = PQgetResult(con)) PQclear(r);
+					streaming = false;
+				}
+
+				statement& execute() {
 					auto n = bindValue.size();
 					int resultFormat = 1; // results in binary format
 
+					PQclear(res);
+					res = nullptr;
+					auto stream = mode_ == fetch_mode::streaming || mode_ == fetch_mode::cursor;
+					if (stream && !c.pipelined) return execute_streaming();
+					if (c.pipelined) {
+						auto ok = PQsendQueryPrepared(
+								con,
+								name.c_str(),
+								n,
+								n ? &bindValue[0] : nullptr,
+								n ? &bindLength[0] : nullptr,
+								n ? &bindFormat[0] : nullptr,
+								resultFormat);
+						if (!ok) raise_error(con, "PQsendQueryPrepared");
+						c.queue(this, false, key);
+						queued = true;
+						return *this;
+					}
 					res = PQexecPrepared(
 							con,
 							name.c_str(),
 							n,
-							n ? static_cast<char **>(&bindValue[0]) : nullptr,
-							n ? static_cast<int*>(&bindLength[0]) : nullptr,
-							n ? static_cast<int*>(&bindFormat[0]) : nullptr,
+							n ? &bindValue[0] : nullptr,
+							n ? &bindLength[0] : nullptr,
+							n ? &bindFormat[0] : nullptr,
 							resultFormat);
+					check_result("PQexecPrepared");
 					return *this;
 				}
 
-				void prepare()  {
-					const Oid* paramTypes;
-					prepare_res = PQprepare(
+				statement& execute_streaming() {
+					auto n = bindValue.size();
+					auto ok = PQsendQueryPrepared(
 							con,
 							name.c_str(),
-							sql_.c_str(),
-							0,
-							paramTypes);
+							n,
+							n ? &bindValue[0] : nullptr,
+							n ? &bindLength[0] : nullptr,
+							n ? &bindFormat[0] : nullptr,
+							1);
+					if (!ok) raise_error(con, "PQsendQueryPrepared");
+#ifdef LIBPQ_HAS_CHUNK_MODE
+					ok = PQsetChunkedRowsMode(con, chunk_rows);
+#else
+					ok = PQsetSingleRowMode(con);
+#endif
+					if (!ok) DB_WARN("streaming mode not set, result is buffered");
+					streaming = true;
+
+					res = PQgetResult(con);
+					switch(PQresultStatus(res)) {
+						case PGRES_SINGLE_TUPLE:
+#ifdef LIBPQ_HAS_CHUNK_MODE
+						case PGRES_TUPLES_CHUNK:
+#endif
+							break;
+						case PGRES_TUPLES_OK: // no rows (or mode not set): complete already
+						case PGRES_COMMAND_OK:
+						case PGRES_EMPTY_QUERY:
+							drain();
+							break;
+						default: {
+							string msg = PQresultErrorMessage(res);
+							drain();
+							raise_error("PQsendQueryPrepared: " + msg);
+						}
+					}
+					return *this;
+				}
+
+#ifdef CPPSTDDB_REACTOR
+				void send(done_type done) {
+					PQclear(res);
+					res = nullptr;
+					if (PQsetnonblocking(con, 1)) raise_error(con, "PQsetnonblocking");
+					auto ok = preparing ?
+						PQsendPrepare(con, name.c_str(), sql_.c_str(), param_types.size(), param_types.data()) :
+						send_prepared();
+					if (!ok) {
+						PQsetnonblocking(con, 0);
+						raise_error(con, preparing ? "PQsendPrepare" : "PQsendQueryPrepared");
+					}
+					DB_TRACE("async send: " << name);
+					// first poll flushes the request, later ones wait for the reply
+					watch(EPOLLOUT | EPOLLIN, std::move(done));
 				}
 
+				int send_prepared() {
+					auto n = bindValue.size();
+					int resultFormat = 1;
+					return PQsendQueryPrepared(
+							con,
+							name.c_str(),
+							n,
+							n ? &bindValue[0] : nullptr,
+							n ? &bindLength[0] : nullptr,
+							n ? &bindFormat[0] : nullptr,
+							resultFormat);
+				}
+
+				void watch(uint32_t events, done_type done) {
+					reactor::instance().watch(PQsocket(con), events, [this, done] {poll(done);});
+				}
+
+				// runs on a reactor thread whenever the socket is ready
+				void poll(const done_type& done) {
+					try {
+						auto flushed = PQflush(con);
+						if (flushed < 0) raise_error(con, "PQflush");
+						if (!PQconsumeInput(con)) raise_error(con, "PQconsumeInput");
+						if (flushed == 1) return watch(EPOLLOUT | EPOLLIN, done);
+
+						// collect results until libpq reports the command complete (null)
+						while (!PQisBusy(con)) {
+							auto r = PQgetResult(con);
+							if (r) {
+								if (res) PQclear(r); else res = r;
+								continue;
+							}
+							if (preparing) {
+								// prepared: now the query itself
+								check_result("PQsendPrepare");
+								preparing = false;
+								PQclear(res);
+								res = nullptr;
+								if (!send_prepared()) raise_error(con, "PQsendQueryPrepared");
+								return watch(EPOLLOUT | EPOLLIN, done);
+							}
+							finish_async();
+							if (ddl) bump_schema_epoch();
+							check_result("PQsendQueryPrepared");
+							done(nullptr);
+							return;
+						}
+						watch(EPOLLIN, done);
+					} catch (...) {
+						if (preparing) prepared = preparing = false; // don't keep the failed name
+						finish_async();
+						done(std::current_exception());
+					}
+				}
+
+				void finish_async() {
+					reactor::instance().forget(PQsocket(con));
+					PQsetnonblocking(con, 0);
+					sending = false;
+				}
+#endif
+
+				void bind(int) {}
+
+				template<class T, class... Args> void bind(int idx, const T& t, const Args&... args) {
+					using param_type = param<policy_type,std::decay_t<const T>>;
+					bindValue[idx] = param_type::value(t, &bindData[8 * idx]);
+					bindLength[idx] = param_type::length(t);
+					bind(idx + 1, args...);
+				}
 		};
 
 		template<class P> struct describe_type {
@@ -194,30 +1011,44 @@ namespace cppstddb { namespace postgres {
 				PGresult *res;
 				unsigned int columns;
 				int status;
-				int row;
+				int row; // first row of the current block
 				int rows;
+				int row_array_size;
+				int block; // rows in the current block
 				bool hasResult_;
 			public:
 				using describe_type = describe_type<policy_type>;
 				using describe_vector = std::vector<describe_type>;
 				using bind_vector = std::vector<bind_type>;
 
-				describe_vector describes;
-				bind_vector binds;
+				// shared through the process wide metadata cache
+				struct metadata_type {
+					describe_vector describes;
+					bind_vector binds;
+				};
+				using cache_type = metadata_cache<metadata_type>;
+
+				std::shared_ptr<metadata_type> metadata;
+				describe_vector& describes;
+				bind_vector& binds;
 
 				//static const maxData = 256;
 
-				rowset(statement& stmt_, int rowArraySize_):
+				rowset(statement& stmt_, int row_array_size_):
 					stmt(stmt_),
 					con(stmt_.con),
-					res(stmt.res),
+					res(stmt_.result()),
 					columns(0),
 					row(0),
-					rows(0)
+					rows(0),
+					row_array_size(row_array_size_ > 0 ? row_array_size_ : 1),
+					block(0),
+					metadata(load_metadata()),
+					describes(metadata->describes),
+					binds(metadata->binds)
 			{
+				columns = describes.size();
 				setup();
-				build_describe();
-				build_bind();
 			}
 
 				~rowset() {
@@ -234,22 +1065,48 @@ namespace cppstddb { namespace postgres {
 					status = PQresultStatus(res);
 					rows = PQntuples(res);
 
-					// not handling PGRESS_SINGLE_TUPLE yet
 					if (status == PGRES_COMMAND_OK) {
 						close();
 						return false;
 					} else if (status == PGRES_EMPTY_QUERY) {
 						close();
 						return false;
-					} else if (status == PGRES_TUPLES_OK) {
+					} else if (status == PGRES_TUPLES_OK || status == PGRES_SINGLE_TUPLE) {
+						return true;
+#ifdef LIBPQ_HAS_CHUNK_MODE
+					} else if (status == PGRES_TUPLES_CHUNK) {
 						return true;
+#endif
 					} else raise_error("setup error");
 					return true;
 				}
 
-				void build_describe() {
-					// called after next()
-					columns = PQnfields(res);
+				std::shared_ptr<metadata_type> load_metadata() {
+					if (!res || !PQnfields(res)) return std::make_shared<metadata_type>();
+					auto key = stmt.c.metadata_prefix + (stmt.key.empty() ? stmt.sql_ : stmt.key);
+					auto& cache = cache_type::instance();
+					if (auto m = cache.find(key)) {
+						if (matches(*m, res)) return m;
+						DB_DEBUG("metadata changed: " << key); // schema changed elsewhere
+					}
+					auto m = std::make_shared<metadata_type>();
+					build_describe(res, m->describes);
+					build_bind(m->describes, m->binds);
+					cache.insert(key, m);
+					return m;
+				}
+
+				// the result's own column count and types agree with cached metadata
+				static bool matches(const metadata_type& m, PGresult* res) {
+					if (int(m.describes.size()) != PQnfields(res)) return false;
+					for(int col = 0; col != PQnfields(res); ++col) {
+						if (m.describes[col].dbType != static_cast<int>(PQftype(res, col))) return false;
+					}
+					return true;
+				}
+
+				static void build_describe(PGresult* res, describe_vector& describes) {
+					int columns = PQnfields(res);
 					DB_TRACE("build describe: columns: " << columns);
 
 					for (int col = 0; col != columns; col++) {
@@ -262,8 +1119,9 @@ namespace cppstddb { namespace postgres {
 					}
 				}
 
-				void build_bind() {
+				static void build_bind(const describe_vector& describes, bind_vector& binds) {
 					// artificial bind setup
+					int columns = describes.size();
 					binds.reserve(columns);
 					for(int i = 0; i < columns; ++i) {
 						auto& d = describes[i];
@@ -273,21 +1131,34 @@ namespace cppstddb { namespace postgres {
 						b.type = value_string;
 						b.idx = i;
 						switch(d.dbType) {
-							case VARCHAROID: b.type = value_string; break;
+							case VARCHAROID:
+							case TEXTOID:
+							case BPCHAROID: b.type = value_string; break;
 							case INT4OID: b.type = value_int; break;
+							case INT8OID: b.type = value_int64; break;
+							case FLOAT8OID: b.type = value_double; break;
 							case DATEOID: b.type = value_date; break;
-							default: throw new database_error("unsupported type");
+							default: throw database_error("unsupported type: " + std::to_string(d.dbType));
 						}
 						DB_TRACE("dbType: " << d.dbType << ", type: " << b.type);
 					}
 				}
 
+				// hand out the client side result in blocks; when streaming, move
+				// on to the next result chunk once this one is used up
 				int fetch() {
-					return 1;
+					block = std::min(row_array_size, rows - row);
+					return block;
 				}
 
 				int next() {
-					return ++row != rows ? 1 :0;
+					row += block;
+					if (row == rows && stmt.streaming) {
+						res = stmt.next_result();
+						row = 0;
+						rows = res ? PQntuples(res) : 0;
+					}
+					return fetch();
 				}
 
 				void close() {
@@ -297,11 +1168,18 @@ namespace cppstddb { namespace postgres {
 					res = nullptr;
 				}
 
-				const void* data(int col) const {return PQgetvalue(res, row, col);}
-				bool is_null(int col) const {return PQgetisnull(res, row, col) != 0;}
+				const void* data(const cell_t& cell) const {
+					return PQgetvalue(res, row + cell.row_idx_, cell.bind_.idx);
+				}
+				bool is_null(const cell_t& cell) const {
+					return PQgetisnull(res, row + cell.row_idx_, cell.bind_.idx) != 0;
+				}
+				int len(const cell_t& cell) const {
+					return PQgetlength(res, row + cell.row_idx_, cell.bind_.idx);
+				}
+				auto name(size_t idx) const {return describes[idx].name;}
 				int type(int col) const {return describes[col].dbType;}
 				int format(int col) const {return describes[col].format;}
-				int len(int col) const {return PQgetlength(res, row, col);}
 		};
 
 		inline void check_type(int a, int b) {
@@ -312,13 +1190,34 @@ namespace cppstddb { namespace postgres {
 
 		template<class P> struct field<P,std::string> {
 			static std::string as(const rowset<P>& r, const cell_t<P>& cell) {
-				return static_cast<const char *>(r.data(cell.bind_.idx));
+				return std::string(static_cast<const char *>(r.data(cell)), r.len(cell));
+			}
+		};
+
+		template<class P> struct field<P,string_view> {
+			static string_view as(const rowset<P>& r, const cell_t<P>& cell) {
+				return string_view(static_cast<const char *>(r.data(cell)), r.len(cell));
 			}
 		};
 
 		template<class P> struct field<P,int> {
 			static int as(const rowset<P>& r, const cell_t<P>& cell) {
-				return big4_to_native(r.data(cell.bind_.idx));
+				return big4_to_native(r.data(cell));
+			}
+		};
+
+		template<class P> struct field<P,int64_t> {
+			static int64_t as(const rowset<P>& r, const cell_t<P>& cell) {
+				return big8_to_native(r.data(cell));
+			}
+		};
+
+		template<class P> struct field<P,double> {
+			static double as(const rowset<P>& r, const cell_t<P>& cell) {
+				auto i = big8_to_native(r.data(cell));
+				double d;
+				memcpy(&d, &i, sizeof(d));
+				return d;
 			}
 		};
 
@@ -327,10 +1226,10 @@ namespace cppstddb { namespace postgres {
 				check_type(r.type(cell.bind_.idx),DATEOID);
 
 				// need to clarify the right endian approach
-				//date d = big4_to_native(r.data(cell.bind_.idx));
+				//date d = big4_to_native(r.data(cell));
 
 				// this works
-				auto a = static_cast<const unsigned char *>(r.data(cell.bind_.idx));
+				auto a = static_cast<const unsigned char *>(r.data(cell));
 				date d = (a[0] << 24) | (a[1] << 16) | (a[2] << 8) | a[3];
 
 				int mdy[3];
@@ -339,6 +1238,76 @@ namespace cppstddb { namespace postgres {
 			}
 		};
 
+		// input parameters, sent in binary format (see statement::query(args...))
+		// value() returns a pointer to the encoded value, using buf (8 bytes) if needed
+
+		template<class P, typename T> struct param {};
+
+		template<class P> struct param<P,int> {
+			static const Oid oid = INT4OID;
+			static int length(int) {return 4;}
+			static const char* value(int v, char* buf) {
+				native_to_big4(v, buf);
+				return buf;
+			}
+		};
+
+		template<class P> struct param<P,int64_t> {
+			static const Oid oid = INT8OID;
+			static int length(int64_t) {return 8;}
+			static const char* value(int64_t v, char* buf) {
+				native_to_big8(v, buf);
+				return buf;
+			}
+		};
+
+		template<class P> struct param<P,double> {
+			static const Oid oid = FLOAT8OID;
+			static int length(double) {return 8;}
+			static const char* value(double v, char* buf) {
+				int64_t i;
+				memcpy(&i, &v, sizeof(i));
+				native_to_big8(i, buf);
+				return buf;
+			}
+		};
+
+		template<class P> struct param<P,const char*> {
+			static const Oid oid = TEXTOID;
+			static int length(const char* v) {return strlen(v);}
+			static const char* value(const char* v, char*) {return v;}
+		};
+
+		template<class P> struct param<P,std::string> {
+			static const Oid oid = TEXTOID;
+			static int length(const std::string& v) {return v.size();}
+			static const char* value(const std::string& v, char*) {return v.data();}
+		};
+
+		template<class P> struct param<P,string_view> {
+			static const Oid oid = TEXTOID;
+			static int length(const string_view& v) {return v.size();}
+			static const char* value(const string_view& v, char*) {return v.data();}
+		};
+
+		template<class P> struct param<P,date_t> {
+			static const Oid oid = DATEOID;
+			static int length(const date_t&) {return 4;}
+			static const char* value(const date_t& v, char* buf) {
+				int mdy[3] = {v.month(), v.day(), v.year()};
+				date d;
+				PGTYPESdate_mdyjul(mdy, &d);
+				native_to_big4(d, buf);
+				return buf;
+			}
+		};
+
+		template<class P> struct param<P,std::nullptr_t> {
+			static const Oid oid = 0;
+			static int length(std::nullptr_t) {return 0;}
+			static const char* value(std::nullptr_t, char*) {return nullptr;}
+		};
+
 	}
 
 	using database = cppstddb::front::basic_database<impl::database<default_policy>>;
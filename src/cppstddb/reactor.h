@@ -0,0 +1,129 @@
+#ifndef CPPSTDDB_REACTOR_H
+#define CPPSTDDB_REACTOR_H
+
+#ifdef __linux__
+
+#include <cppstddb/log.h>
+#include <cppstddb/database_error.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define CPPSTDDB_REACTOR 1
+
+/*
+   A small epoll reactor shared by the drivers' async paths (linux only;
+   elsewhere CPPSTDDB_REACTOR is not defined and the drivers run async
+   queries synchronously).
+   Watches are one shot (EPOLLONESHOT): when a socket becomes ready its
+   callback runs once on one of the reactor threads and must call watch()
+   again to wait for more. This also guarantees that a given socket is
+   never serviced by two reactor threads at the same time.
+ */
+
+namespace cppstddb {
+
+    class reactor {
+        public:
+            using callback = std::function<void()>;
+            using guard_t = std::lock_guard<std::mutex>;
+
+            static const size_t default_threads = 2;
+
+            // process wide instance, started on first use
+            static reactor& instance() {
+                static reactor r(default_threads);
+                return r;
+            }
+
+            explicit reactor(size_t threads):
+                epoll_(epoll_create1(EPOLL_CLOEXEC)),
+                wake_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+                    if (epoll_ < 0 || wake_ < 0) throw database_error("reactor: epoll setup failed");
+                    epoll_event e = {};
+                    e.events = EPOLLIN; // level triggered: wakes every thread on shutdown
+                    e.data.fd = wake_;
+                    epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &e);
+                    for(size_t i = 0; i != (threads ? threads : 1); ++i) {
+                        threads_.emplace_back([this] {run();});
+                    }
+                    DB_DEBUG("reactor: started " << threads_.size() << " threads");
+                }
+
+            ~reactor() {
+                uint64_t one = 1;
+                if (write(wake_, &one, sizeof(one)) < 0) DB_WARN("reactor: wake failed");
+                for(auto& t : threads_) t.join();
+                close(wake_);
+                close(epoll_);
+            }
+
+            reactor(const reactor&) = delete;
+            reactor& operator=(const reactor&) = delete;
+
+            // run cb once when fd is ready for events (EPOLLIN/EPOLLOUT)
+            void watch(int fd, uint32_t events, callback cb) {
+                guard_t guard(mutex_);
+                auto i = watches_.find(fd);
+                auto op = i == watches_.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+                watches_[fd] = std::move(cb);
+                epoll_event e = {};
+                e.events = events | EPOLLONESHOT;
+                e.data.fd = fd;
+                if (epoll_ctl(epoll_, op, fd, &e) < 0) {
+                    watches_.erase(fd);
+                    throw database_error("reactor: epoll_ctl failed", errno);
+                }
+            }
+
+            // stop watching fd (before it goes back to blocking use or is closed)
+            void forget(int fd) {
+                guard_t guard(mutex_);
+                if (!watches_.erase(fd)) return;
+                epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+            }
+
+        private:
+            int epoll_;
+            int wake_;
+            std::mutex mutex_;
+            std::unordered_map<int, callback> watches_;
+            std::vector<std::thread> threads_;
+
+            void run() {
+                const int max_events = 64;
+                epoll_event events[max_events];
+                for(;;) {
+                    int n = epoll_wait(epoll_, events, max_events, -1);
+                    if (n < 0) {
+                        if (errno == EINTR) continue;
+                        DB_ERROR("reactor: epoll_wait: " << errno);
+                        return;
+                    }
+                    for(int i = 0; i != n; ++i) {
+                        auto fd = events[i].data.fd;
+                        if (fd == wake_) return;
+                        callback cb;
+                        {
+                            guard_t guard(mutex_);
+                            auto w = watches_.find(fd);
+                            if (w == watches_.end()) continue;
+                            cb.swap(w->second);
+                        }
+                        if (cb) cb();
+                    }
+                }
+            }
+    };
+
+}
+
+#endif // __linux__
+
+#endif
@@ -3,25 +3,54 @@
 
 #include <string>
 #include <ostream>
+#include <vector>
+#include <utility>
 
 namespace cppstddb {
+
+    // how a connection is opened (see pool_options::readers)
+    enum class access_mode {
+        read_write,
+        read_only,
+        writer,     // the single read write connection beside read only ones (sqlite: wal journal)
+    };
+
     struct source {
         typedef std::string string;
+        typedef std::vector<std::pair<string,string>> options_type;
         string protocol;
-        string server;
-        int port;
+        string server;      // host name, ipv6 address (no brackets), socket directory/path, or file
+        int port = 0;       // 0: none given, the driver's default
         string database;
         string username;
         string password;
+        options_type options; // other query string keys, in uri order
+        access_mode access = access_mode::read_write;
+
+        // a unix domain socket rather than a host
+        bool is_unix_socket() const {return !server.empty() && server[0] == '/';}
+
+        // value of the last occurrence of key, or nullptr
+        const string* option(const string& key) const {
+            for(auto i = options.rbegin(); i != options.rend(); ++i) if (i->first == key) return &i->second;
+            return nullptr;
+        }
+
+        string option(const string& key, const string& default_value) const {
+            auto v = option(key);
+            return v ? *v : default_value;
+        }
     };
 
     inline std::ostream& operator<<(std::ostream& os, const source &s) {
         os << "(";
         os << "protocol: " << s.protocol;
         os << ", server: " << s.server;
+        os << ", port: " << s.port;
         os << ", database: " << s.database;
         os << ", username: " << s.username;
         os << ", password: " << "*****";
+        for(auto& o : s.options) os << ", " << o.first << ": " << o.second;
         os << ")";
         return os;
     }
@@ -4,14 +4,21 @@
 #include <cppstddb/front.h>
 #include <cppstddb/util.h>
 #include <cppstddb/date_parse.h>
+#include <cppstddb/statement_cache.h>
+#include <cppstddb/metadata_cache.h>
 #include <vector>
 #include <sstream>
+#include <tuple>
+#include <algorithm>
 #include <sqlite3.h>
 //#include <sqlite3ext.h>
 #include <cstring>
+#include <climits>
 
 namespace cppstddb { namespace sqlite {
 
+	static const log_category db_log_category = log_category::sqlite;
+
 	namespace impl {
 
 		template<class P> class database;
@@ -20,6 +27,7 @@ namespace cppstddb { namespace sqlite {
 		template<class P> class rowset;
 		template<class P> struct bind_type;
 		template<class P,class T> struct field;
+		template<class P,class T> struct param;
 
 		template<class P> using cell_t = cppstddb::front::cell<database<P>>;
 
@@ -60,6 +68,144 @@ namespace cppstddb { namespace sqlite {
 			return ret;
 		}
 
+		// how a connection is opened and set up, from the uri options
+		// (file://path?journal_mode=wal&mmap_size=268435456). a profile option
+		// names a preset that the other options override
+		struct open_settings {
+			using string = std::string;
+			using setting = std::pair<string,string>;
+
+			string filename;
+			int flags;
+			int busy_timeout; // ms, -1 when not set
+			std::vector<setting> pragmas; // in the order they are applied
+
+			explicit open_settings(const source& src):filename(src.server),flags(0),busy_timeout(-1) {
+				std::vector<setting> uri_params; // handled by sqlite's own uri filenames
+				if (auto profile = src.option("profile")) apply_profile(*profile);
+				for(auto& o : src.options) {
+					auto& key = o.first;
+					auto& value = o.second;
+					if (key == "profile") continue;
+					check_value(key, value);
+					if (key == "busy_timeout") {
+						busy_timeout = milliseconds(key, value);
+					} else if (key == "mutex") {
+						if (value == "no") flags |= SQLITE_OPEN_NOMUTEX;
+						else if (value == "full") flags |= SQLITE_OPEN_FULLMUTEX;
+						else raise_error("sqlite option mutex: no or full: " + value);
+					} else if (is_uri_param(key)) {
+						uri_params.emplace_back(key, value);
+					} else if (is_pragma(key)) {
+						set(key, value);
+					} else {
+						DB_WARN("sqlite: ignoring uri option: " << key);
+					}
+				}
+				if (!uri_params.empty()) make_uri_filename(uri_params);
+			}
+
+			// page_size first: it can't change once the journal is wal
+			static const char* const* pragma_names() {
+				static const char* const names[] = {
+					"page_size", "locking_mode", "journal_mode", "synchronous",
+					"cache_size", "mmap_size", "temp_store", nullptr};
+				return names;
+			}
+
+			static bool is_pragma(const string& key) {
+				for(auto n = pragma_names(); *n; ++n) if (key == *n) return true;
+				return false;
+			}
+
+			static bool is_uri_param(const string& key) {
+				return key == "immutable" || key == "nolock" || key == "mode" || key == "cache" || key == "vfs";
+			}
+
+			// values go into pragma text: plain words and numbers only
+			static void check_value(const string& key, const string& value) {
+				if (value.empty()) raise_error("sqlite option without value: " + key);
+				for(auto c : value) {
+					if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+						raise_error("sqlite option " + key + ": bad value: " + value);
+					}
+				}
+			}
+
+			static int milliseconds(const string& key, const string& value) {
+				long long ms = 0;
+				for(auto c : value) {
+					if (!isdigit(static_cast<unsigned char>(c)) || (ms = ms * 10 + (c - '0')) > INT_MAX) {
+						raise_error("sqlite option " + key + ": not a number of ms: " + value);
+					}
+				}
+				return static_cast<int>(ms);
+			}
+
+			// value of a pragma to apply, or nullptr
+			const string* pragma(const string& key) const {
+				for(auto& p : pragmas) if (p.first == key) return &p.second;
+				return nullptr;
+			}
+
+			void set(const string& key, const string& value) {
+				for(auto& p : pragmas) {
+					if (p.first == key) {
+						p.second = value;
+						return;
+					}
+				}
+				pragmas.emplace_back(key, value);
+				auto rank = [](const string& k) {
+					int i = 0;
+					for(auto n = pragma_names(); *n && k != *n; ++n) ++i;
+					return i;
+				};
+				std::stable_sort(pragmas.begin(), pragmas.end(), [&rank](const setting& a, const setting& b) {
+						return rank(a.first) < rank(b.first);
+						});
+			}
+
+			void apply_profile(const string& name) {
+				if (name == "bulk_load") {
+					// one loading process: no fsync, large cache. locking is left
+					// normal so pooled and read only connections can still open
+					set("journal_mode", "wal");
+					set("synchronous", "off");
+					set("cache_size", "-262144"); // KiB
+					set("temp_store", "memory");
+				} else if (name == "read_mostly") {
+					// concurrent readers, durable enough commits, file mapped reads
+					set("journal_mode", "wal");
+					set("synchronous", "normal");
+					set("mmap_size", "268435456");
+					set("cache_size", "-65536");
+					set("temp_store", "memory");
+					busy_timeout = 5000;
+				} else {
+					raise_error("sqlite: unknown profile: " + name);
+				}
+			}
+
+			void make_uri_filename(const std::vector<setting>& params) {
+				string uri = "file:";
+				for(auto c : filename) {
+					if (c == '%') uri += "%25";
+					else if (c == '?') uri += "%3f";
+					else if (c == '#') uri += "%23";
+					else uri += c;
+				}
+				char sep = '?';
+				for(auto& p : params) {
+					uri += sep;
+					uri += p.first + "=" + p.second;
+					sep = '&';
+				}
+				filename = uri;
+				flags |= SQLITE_OPEN_URI;
+			}
+		};
+
 		template<class P> class database {
 			public:
 				using policy_type = P;
@@ -70,7 +216,20 @@ namespace cppstddb { namespace sqlite {
 				using bind_type = bind_type<policy_type>;
 				template<typename T> using field_type = field<policy_type,T>;
 
-                string date_column_type() const {return "text";}
+				string date_column_type() const {return "text";}
+				string placeholder(int) const {return "?";}
+				// typed rowsets: sqlite is dynamically typed, so text converts to
+				// anything, anything to text, and numbers to each other
+				static bool accepts(value_type column, value_type requested) {
+					return
+						column == requested ||
+						column == value_string ||
+						column == value_variant ||
+						requested == value_string ||
+						(numeric(column) && numeric(requested));
+				}
+
+				static bool numeric(value_type t) {return t == value_int || t == value_int64 || t == value_double;}
 
 			public:
 				database() {
@@ -86,12 +245,18 @@ namespace cppstddb { namespace sqlite {
 				using policy_type = P;
 				using string = typename policy_type::string;
 				using database = database<policy_type>;
+				using statement_cache = statement_cache<sqlite3_stmt*>;
 				sqlite3* sq;
 				string path;
 			public:
 				database& db;
+				statement_cache statements;
 
-				connection(database& db_, const source& src):db(db_) {
+				connection(database& db_, const source& src):
+					db(db_),
+					statements([](sqlite3_stmt* st) {
+							check_nothrow("sqlite3_finalize", sqlite3_finalize(st));
+							}) {
 					if (src.protocol == "sqlite")
 						raise_error("uri protocol: use file instead of sqlite");
 					else if (src.protocol != "file")
@@ -101,32 +266,212 @@ namespace cppstddb { namespace sqlite {
 
 					DB_TRACE("con: sqlite opening file: " << path);
 
-					int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
-					check("sqlite3_open_v2", sq, sqlite3_open_v2(path.c_str(), &sq, flags, nullptr));
+					open_settings settings(src);
+					// read only connections beside the writer need a wal journal
+					auto journal = settings.pragma("journal_mode");
+					if (src.access == access_mode::writer && journal && !is_wal(*journal)) {
+						raise_error("sqlite option journal_mode=" + *journal + ": readers need wal");
+					}
+					int flags = settings.flags | (src.access == access_mode::read_only ?
+						SQLITE_OPEN_READONLY :
+						SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+					sq = nullptr;
+					try {
+						check("sqlite3_open_v2", sq, sqlite3_open_v2(settings.filename.c_str(), &sq, flags, nullptr));
+
+						// one writer beside read only connections: with a wal journal,
+						// readers proceed while the writer commits. both sides still
+						// wait out the short locks taken by checkpoints
+						auto busy_timeout = settings.busy_timeout;
+						if (busy_timeout < 0 && src.access != access_mode::read_write) busy_timeout = busy_timeout_ms;
+						if (busy_timeout >= 0) sqlite3_busy_timeout(sq, busy_timeout);
+
+						for(auto& p : settings.pragmas) {
+							// the file's format is the writer's business
+							if (src.access == access_mode::read_only && (p.first == "journal_mode" || p.first == "page_size")) continue;
+							exec(("pragma " + p.first + "=" + p.second).c_str());
+						}
+						if (src.access == access_mode::writer && !journal) exec("pragma journal_mode=wal");
+					} catch (...) {
+						if (sq) sqlite3_close(sq);
+						throw;
+					}
+				}
+
+				static const int busy_timeout_ms = 5000;
+
+				static bool is_wal(const string& mode) {
+					return mode.size() == 3 && tolower(mode[0]) == 'w' && tolower(mode[1]) == 'a' && tolower(mode[2]) == 'l';
 				}
 
 				~connection() {
 					DB_TRACE("~con: sqlite closing " << path);
+					statements.clear();
 					if (sq) check_nothrow("sqlite3_close", sqlite3_close(sq));
 				}
 
-        void begin() {
-          DB_TRACE("begin");
-          char* zErrMsg = nullptr;
-          int res = sqlite3_exec(sq, "begin", nullptr, nullptr, &zErrMsg);
-        }
+				void begin() {
+					DB_TRACE("begin");
+					exec("begin");
+				}
 
-        void commit() {
-          DB_TRACE("commit");
-          char* zErrMsg = nullptr;
-          int res = sqlite3_exec(sq, "commit", nullptr, nullptr, &zErrMsg);
-        }
+				void commit() {
+					DB_TRACE("commit");
+					exec("commit");
+				}
+
+				void rollback() {
+					DB_TRACE("rollback");
+					exec("rollback");
+				}
+
+				// before the pool hands the connection out again: statements left
+				// mid step hold their read locks, and an open transaction is rolled back
+				bool reset() {
+					for(auto st = sqlite3_next_stmt(sq, nullptr); st; st = sqlite3_next_stmt(sq, st)) {
+						if (sqlite3_stmt_busy(st)) sqlite3_reset(st);
+					}
+					if (!sqlite3_get_autocommit(sq)) rollback();
+					return true;
+				}
+
+				void exec(const char* sql) {
+					char* zErrMsg = nullptr;
+					int res = sqlite3_exec(sq, sql, nullptr, nullptr, &zErrMsg);
+					if (is_ddl(sql)) bump_schema_epoch();
+					if (res != SQLITE_OK) {
+						string msg = zErrMsg ? zErrMsg : sqlite3_errmsg(sq);
+						sqlite3_free(zErrMsg);
+						throw database_error(sql, res, msg);
+					}
+				}
+
+				static const int max_rows_per_insert = 256;
+
+				// bulk insert of a (forward) range of tuples, one value per column.
+				// rows go out as multi-row VALUES statements (as many rows as the
+				// variable limit allows, up to max_rows_per_insert) inside explicit
+				// transactions committed every commit_rows rows. when a transaction
+				// is already open, it is used as is. table and column names are
+				// quoted. returns the rows inserted
+				template<class R> size_t insert_many(
+						const string& table,
+						const std::vector<string>& columns,
+						const R& range,
+						size_t commit_rows = 10000) {
+					using row_type = std::decay_t<decltype(*std::begin(range))>;
+					if (columns.size() != std::tuple_size<row_type>::value) raise_error("insert_many: column count mismatch", columns.size());
+					int width = columns.size();
+					int max_vars = sqlite3_limit(sq, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+					int per_insert = std::max(1, std::min(int(max_rows_per_insert), max_vars / width));
+
+					bool own_transaction = sqlite3_get_autocommit(sq) != 0;
+					if (own_transaction) begin();
+					size_t count = 0, uncommitted = 0;
+					sqlite3_stmt* full = nullptr;
+					sqlite3_stmt* tail = nullptr;
+					int n = 0;
+					try {
+						full = prepare_insert(table, columns, per_insert);
+						auto i = std::begin(range), e = std::end(range);
+						while (i != e) {
+							auto group = i;
+							for(n = 0; i != e && n != per_insert; ++i, ++n) bind_row(full, n * width + 1, *i);
+							sqlite3_stmt* st = full;
+							if (n != per_insert) {
+								// last, partial group: rebind into a statement of its size
+								sqlite3_clear_bindings(full);
+								st = tail = prepare_insert(table, columns, n);
+								for(int k = 0; k != n; ++k, ++group) bind_row(st, k * width + 1, *group);
+							}
+							auto status = sqlite3_step(st);
+							if (status != SQLITE_DONE) raise_error("insert_many: step error", sq, status);
+							sqlite3_reset(st);
+
+							count += n;
+							uncommitted += n;
+							if (own_transaction && uncommitted >= commit_rows) {
+								commit();
+								begin();
+								uncommitted = 0;
+							}
+						}
+						if (own_transaction) commit();
+						finish_insert(table, columns, per_insert, full);
+						finish_insert(table, columns, n, tail);
+					} catch (...) {
+						finish_insert(table, columns, per_insert, full);
+						finish_insert(table, columns, n, tail);
+						if (own_transaction) {
+							try {rollback();} catch (const database_error& e) {DB_ERROR("insert_many: " << e.what());}
+						}
+						throw;
+					}
+					DB_DEBUG("insert_many: " << count << " rows into " << table);
+					return count;
+				}
+
+			private:
+				// "name", embedded quotes doubled
+				static string quote_identifier(const string& name) {
+					string quoted = "\"";
+					for(auto c : name) {
+						if (c == '"') quoted += '"';
+						quoted += c;
+					}
+					return quoted + "\"";
+				}
 
-        void rollback() {
-          DB_TRACE("rollback");
-          char* zErrMsg = nullptr;
-          int res = sqlite3_exec(sq, "rollback", nullptr, nullptr, &zErrMsg);
-        }
+				// schema.table is quoted per part
+				static string quote_table(const string& name) {
+					auto dot = name.find('.');
+					if (dot == string::npos) return quote_identifier(name);
+					return quote_identifier(name.substr(0, dot)) + "." + quote_identifier(name.substr(dot + 1));
+				}
+
+				static string insert_sql(const string& table, const std::vector<string>& columns, int rows) {
+					string sql = "insert into " + quote_table(table) + " (";
+					string values = "(";
+					for(size_t i = 0; i != columns.size(); ++i) {
+						if (i) {sql += ","; values += ",";}
+						sql += quote_identifier(columns[i]);
+						values += "?";
+					}
+					sql += ") values ";
+					values += ")";
+					for(int r = 0; r != rows; ++r) {
+						if (r) sql += ",";
+						sql += values;
+					}
+					return sql;
+				}
+
+				// insert statements go through the statement cache like any other
+				sqlite3_stmt* prepare_insert(const string& table, const std::vector<string>& columns, int rows) {
+					auto sql = insert_sql(table, columns, rows);
+					sqlite3_stmt* st = nullptr;
+					if (!statements.take(sql, st)) {
+						check("sqlite3_prepare_v2", sq, sqlite3_prepare_v2(sq, sql.c_str(), (int)sql.size() + 1, &st, nullptr));
+					}
+					return st;
+				}
+
+				// reset and hand back to the cache
+				void finish_insert(const string& table, const std::vector<string>& columns, int rows, sqlite3_stmt* st) {
+					if (!st) return;
+					sqlite3_reset(st);
+					sqlite3_clear_bindings(st);
+					statements.put(insert_sql(table, columns, rows), st);
+				}
+
+				template<class... T> void bind_row(sqlite3_stmt* st, int idx, const std::tuple<T...>& row) {
+					bind_fields(st, idx, row, std::index_sequence_for<T...>());
+				}
+
+				template<class... T, size_t... I> void bind_fields(sqlite3_stmt* st, int idx, const std::tuple<T...>& row, std::index_sequence<I...>) {
+					int expand[] = {0, (check("sqlite3_bind", sq, param<policy_type,std::decay_t<const T>>::bind(st, idx + I, std::get<I>(row))), 0)...};
+					(void) expand;
+				}
 		};
 
 		template<class P> class statement {
@@ -148,6 +493,7 @@ namespace cppstddb { namespace sqlite {
 				sqlite3_stmt *st;
 				bool has_rows;
 				int binds;
+				bool ddl; // cached result metadata may be stale once it ran
 
 			public:
 				statement(connection& con_, const string& sql_):
@@ -157,38 +503,58 @@ namespace cppstddb { namespace sqlite {
 					state(state_init),
 					st(nullptr),
 					has_rows(false),
-					binds(0) {
+					binds(0),
+					ddl(is_ddl(sql)) {
 						DB_TRACE("stmt: " << sql);
 					}
 
 				~statement() {
 					DB_TRACE("~stmt");
-					if (st) check_nothrow("sqlite3_finalize", sqlite3_finalize(st));
+					if (st) {
+						// hand the reset handle back to the connection for reuse
+						sqlite3_reset(st);
+						sqlite3_clear_bindings(st);
+						con.statements.put(sql, st);
+					}
 				}
 
+				// rows are always stepped out of the engine as they are read
+				void mode(fetch_mode) {}
+				void prefetch(size_t) {}
+
 				void prepare() {
 					if (!st) { 
-						DB_TRACE("prepare sql: " << sql);
-						check("sqlite3_prepare_v2", sqlite3_prepare_v2(
-									sq, 
-									sql.c_str(), 
-									(int)sql.size() + 1, 
-									&st, 
-									nullptr));
+						if (!con.statements.take(sql, st)) {
+							DB_TRACE("prepare sql: " << sql);
+							check("sqlite3_prepare_v2", sqlite3_prepare_v2(
+										sq, 
+										sql.c_str(), 
+										(int)sql.size() + 1, 
+										&st, 
+										nullptr));
+						}
 						binds = sqlite3_bind_parameter_count(st);
 					}
 				}
 
+				template<typename... Args> statement& query(const Args&... args) {
+					if (sizeof...(Args) != binds) raise_error("bind count mismatch", binds);
+					if (state == state_execute) reset();
+					state = state_init;
+					bind(1, args...);
+					return query();
+				}
+
 				statement& query() {
 					if (state == state_execute) return *this;
 					state = state_execute;
 					int status = sqlite3_step(st);
 					DB_TRACE("sqlite3_step: status: " << status);
-					if (status == SQLITE_ROW) {
-						has_rows = true;
-					} else if (status == SQLITE_DONE) {
+					if (ddl) bump_schema_epoch();
+					has_rows = status == SQLITE_ROW;
+					if (status == SQLITE_DONE) {
 						reset();
-					} else {
+					} else if (!has_rows) {
 						//raise_error(sq, "step error", status);
 						raise_error("step error", status);
 					}
@@ -199,6 +565,14 @@ namespace cppstddb { namespace sqlite {
 					check("sqlite3_reset", sqlite3_reset(st));
 				}
 
+			private:
+				void bind(int) {}
+
+				template<class T, class... Args> void bind(int idx, const T& t, const Args&... args) {
+					check("sqlite3_bind", sq, param<policy_type,std::decay_t<const T>>::bind(st, idx, t));
+					bind(idx + 1, args...);
+				}
+
 
 		};
 
@@ -208,6 +582,20 @@ namespace cppstddb { namespace sqlite {
 			bind_type():type(value_undef),idx(0) {}
 		};
 
+		// column type from the declared type, by sqlite's affinity rules;
+		// undeclared (expressions) and numeric affinity columns are typed per row
+		inline value_type declared_type(const char* decl) {
+			if (!decl) return value_variant;
+			std::string d(decl);
+			for(auto& c : d) c = toupper(static_cast<unsigned char>(c));
+			auto has = [&d](const char* s) {return d.find(s) != std::string::npos;};
+			if (has("INT")) return value_int64;
+			if (has("CHAR") || has("CLOB") || has("TEXT")) return value_string;
+			if (has("BLOB")) return value_blob;
+			if (has("REAL") || has("FLOA") || has("DOUB")) return value_double;
+			return value_variant;
+		}
+
 		template<class P> class rowset {
 			public:
 				using policy_type = P;
@@ -219,53 +607,239 @@ namespace cppstddb { namespace sqlite {
 				sqlite3_stmt *st;
 				int columns;
 				int status;
+				int row_array_size;
+				bool done;
 
-				// artifical bind array (for now)
+				// artifical bind array (for now), shared through the metadata cache
 				using bind_vector = std::vector<bind_type>;
-				bind_vector binds;
+				struct metadata_type {
+					std::vector<string> declared; // column decltypes, to check a hit
+					bind_vector binds;
+				};
+				using cache_type = metadata_cache<metadata_type>;
+				std::shared_ptr<metadata_type> metadata;
+				bind_vector& binds;
+
+				// with row_array_size > 1, rows are stepped in blocks and
+				// copied here in their storage class; otherwise cells are read
+				// from the statement
+				struct cell_value {
+					int type; // SQLITE_NULL, SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB
+					int length;
+					union {
+						int64_t i;
+						double d;
+						size_t offset; // into text
+					};
+					mutable char number[24]; // the number read as text
+				};
+				std::vector<cell_value> block;
+				std::vector<char> text; // text and blob bytes
 
 
 			public:
-				rowset(statement& stmt_, int rowArraySize_):
+				rowset(statement& stmt_, int row_array_size_):
 					stmt(stmt_),
 					st(stmt.st),
 					columns(sqlite3_column_count(st)),
-					status(SQLITE_OK) {
-						DB_TRACE("rowset" << ", columns: " << columns);
-
-						// artificial bind setup
-						binds.reserve(columns);
-						for(int i = 0; i < columns; ++i) {
-							binds.push_back(bind_type());
-							auto& b = binds.back();
-							b.type = value_string;
-							b.idx = i;
-							//DB_TRACE("bind: idx: " << b.idx << ", type: " << b.type);
-						}
+					status(SQLITE_OK),
+					row_array_size(row_array_size_ > 0 ? row_array_size_ : 1),
+					done(!stmt.has_rows),
+					metadata(load_metadata()),
+					binds(metadata->binds) {
+						DB_TRACE("rowset" << ", columns: " << columns << ", row_array_size: " << row_array_size);
+						if (row_array_size > 1) block.resize(row_array_size * columns);
+					}
 
+				std::shared_ptr<metadata_type> load_metadata() {
+					if (!columns) return std::make_shared<metadata_type>();
+					auto key = stmt.con.path + "\n" + stmt.sql;
+					auto& cache = cache_type::instance();
+					if (auto m = cache.find(key)) {
+						if (matches(*m, st)) return m;
+						DB_DEBUG("metadata changed: " << key); // schema changed elsewhere
+					}
+					auto m = std::make_shared<metadata_type>();
+
+					m->declared.reserve(columns);
+					m->binds.reserve(columns);
+					for(int i = 0; i < columns; ++i) {
+						auto decl = sqlite3_column_decltype(st, i);
+						m->declared.push_back(decl ? decl : "");
+						m->binds.push_back(bind_type());
+						auto& b = m->binds.back();
+						b.type = declared_type(decl);
+						b.idx = i;
+						DB_TRACE("bind: idx: " << b.idx << ", type: " << b.type);
 					}
+					cache.insert(key, m);
+					return m;
+				}
+
+				// the statement's own columns and declared types agree with cached
+				// metadata (sqlite re-prepares on a schema change, which can change both)
+				static bool matches(const metadata_type& m, sqlite3_stmt* st) {
+					if (int(m.declared.size()) != sqlite3_column_count(st)) return false;
+					for(int i = 0; i != int(m.declared.size()); ++i) {
+						auto decl = sqlite3_column_decltype(st, i);
+						if (m.declared[i] != (decl ? decl : "")) return false;
+					}
+					return true;
+				}
 
 				//bool hasResult() {return result_metadata != null;}
 
 				int fetch() {
-					// step already done by execute
-					return 1; // check
+					// first step already done by execute
+					if (done) return 0;
+					return direct() ? 1 : fill(true);
 				}
 
 				int next() {
+					if (done) return 0;
+					if (direct()) return step() ? 1 : 0;
+					return fill(false);
+				}
+
+				auto name(size_t idx) {
+					auto ptr = sqlite3_column_name(st, idx);
+					return string(ptr,strlen(ptr));
+				}
+
+				bool direct() const {return row_array_size == 1;}
+
+				bool is_null(const cell_t& cell) const {return storage(cell) == SQLITE_NULL;}
+
+				// storage class of the cell in the current row
+				int storage(const cell_t& cell) const {
+					if (direct()) return sqlite3_column_type(st, cell.bind_.idx);
+					return value(cell).type;
+				}
+
+				// the type of this row's value: its storage class, which can differ
+				// from the declared type (text in an integer column is legal)
+				value_type row_type(const cell_t& cell) const {
+					auto declared = cell.bind_.type;
+					switch(storage(cell)) {
+						case SQLITE_NULL: return declared == value_variant ? value_string : declared;
+						case SQLITE_INTEGER: return declared == value_double ? value_double : value_int64;
+						case SQLITE_FLOAT: return value_double;
+						case SQLITE_BLOB: return value_blob;
+						default: return value_string;
+					}
+				}
+
+				int64_t int64(const cell_t& cell) const {
+					if (direct()) return sqlite3_column_int64(st, cell.bind_.idx);
+					auto& v = value(cell);
+					switch(v.type) {
+						case SQLITE_INTEGER: return v.i;
+						case SQLITE_FLOAT: return static_cast<int64_t>(v.d);
+						case SQLITE_TEXT: return strtoll(&text[v.offset], nullptr, 10);
+						default: return 0;
+					}
+				}
+
+				double real(const cell_t& cell) const {
+					if (direct()) return sqlite3_column_double(st, cell.bind_.idx);
+					auto& v = value(cell);
+					switch(v.type) {
+						case SQLITE_INTEGER: return static_cast<double>(v.i);
+						case SQLITE_FLOAT: return v.d;
+						case SQLITE_TEXT: return strtod(&text[v.offset], nullptr);
+						default: return 0;
+					}
+				}
+
+				// nul terminated; a buffered number is formatted into its cell
+				const char* text_ptr(const cell_t& cell, int& length) const {
+					if (direct()) {
+						auto ptr = reinterpret_cast<const char*>(sqlite3_column_text(st, cell.bind_.idx));
+						length = sqlite3_column_bytes(st, cell.bind_.idx);
+						return ptr ? ptr : "";
+					}
+					auto& v = value(cell);
+					switch(v.type) {
+						case SQLITE_TEXT:
+						case SQLITE_BLOB:
+							length = v.length;
+							return &text[v.offset];
+						case SQLITE_INTEGER:
+							length = snprintf(v.number, sizeof(v.number), "%lld", static_cast<long long>(v.i));
+							return v.number;
+						case SQLITE_FLOAT:
+							// sqlite's own rendering (keeps a .0), as in direct mode
+							sqlite3_snprintf(sizeof(v.number), v.number, "%!.15g", v.d);
+							length = strlen(v.number);
+							return v.number;
+						default:
+							length = 0;
+							return "";
+					}
+				}
+
+				blob_view blob(const cell_t& cell) const {
+					if (direct()) {
+						auto ptr = sqlite3_column_blob(st, cell.bind_.idx);
+						return blob_view(ptr, sqlite3_column_bytes(st, cell.bind_.idx));
+					}
+					int length;
+					auto ptr = text_ptr(cell, length);
+					return blob_view(ptr, length);
+				}
+
+			private:
+				const cell_value& value(const cell_t& cell) const {
+					return block[cell.row_idx_ * columns + cell.bind_.idx];
+				}
+
+				bool step() {
 					status = sqlite3_step(st);
-					if (status == SQLITE_ROW) return 1;
+					if (status == SQLITE_ROW) return true;
 					if (status == SQLITE_DONE) {
+						done = true;
 						stmt.reset();
-						return 0;
+						return false;
 					}
 					raise_error("sqlite3_step", status);
-					return 0;
+					return false;
 				}
 
-				auto name(size_t idx) {
-					auto ptr = sqlite3_column_name(st, idx);
-					return string(ptr,strlen(ptr));
+				int fill(bool first) {
+					text.clear();
+					int rows = 0;
+					if (!first && !step()) return 0;
+					do {
+						copy_row(rows++);
+					} while (rows != row_array_size && step());
+					return rows;
+				}
+
+				void copy_row(int row) {
+					auto values = &block[row * columns];
+					for(int i = 0; i != columns; ++i) {
+						auto& v = values[i];
+						v.type = sqlite3_column_type(st, i);
+						v.length = 0;
+						switch(v.type) {
+							case SQLITE_NULL:
+								break;
+							case SQLITE_INTEGER:
+								v.i = sqlite3_column_int64(st, i);
+								break;
+							case SQLITE_FLOAT:
+								v.d = sqlite3_column_double(st, i);
+								break;
+							default: {
+								auto ptr = static_cast<const char*>(
+										v.type == SQLITE_BLOB ? sqlite3_column_blob(st, i) : sqlite3_column_text(st, i));
+								v.length = sqlite3_column_bytes(st, i);
+								v.offset = text.size();
+								text.insert(text.end(), ptr, ptr + v.length);
+								text.push_back(0);
+							}
+						}
+					}
 				}
 		};
 
@@ -273,22 +847,109 @@ namespace cppstddb { namespace sqlite {
 
 		template<class P> struct field<P,std::string> {
 			static std::string as(const rowset<P>& r, const cell_t<P>& cell) {
-				auto ptr = reinterpret_cast<const char*>(sqlite3_column_text(r.st, cell.bind_.idx));
-				return std::string(ptr,strlen(ptr));
+				int length;
+				auto ptr = r.text_ptr(cell, length);
+				return std::string(ptr,length);
+			}
+		};
+
+		template<class P> struct field<P,string_view> {
+			static string_view as(const rowset<P>& r, const cell_t<P>& cell) {
+				int length;
+				auto ptr = r.text_ptr(cell, length);
+				return string_view(ptr,length);
 			}
 		};
 
 		template<class P> struct field<P,int> {
 			static int as(const rowset<P>& r, const cell_t<P>& cell) {
-				return sqlite3_column_int(r.st, cell.bind_.idx);
+				return static_cast<int>(r.int64(cell));
+			}
+		};
+
+		template<class P> struct field<P,int64_t> {
+			static int64_t as(const rowset<P>& r, const cell_t<P>& cell) {
+				return r.int64(cell);
+			}
+		};
+
+		template<class P> struct field<P,double> {
+			static double as(const rowset<P>& r, const cell_t<P>& cell) {
+				return r.real(cell);
+			}
+		};
+
+		template<class P> struct field<P,blob_view> {
+			static blob_view as(const rowset<P>& r, const cell_t<P>& cell) {
+				return r.blob(cell);
 			}
 		};
 
 		template<class P> struct field<P,date_t> {
 			static date_t as(const rowset<P>& r, const cell_t<P>& cell) {
-				auto ptr = reinterpret_cast<const char*>(sqlite3_column_text(r.st, cell.bind_.idx));
-				auto d = std::string(ptr,strlen(ptr));
-				return cppstddb::impl::date_parse(d);
+				int length;
+				return cppstddb::impl::date_parse(r.text_ptr(cell, length));
+			}
+		};
+
+		// input parameter binding (see statement::query(args...))
+
+		template<class P, typename T> struct param {};
+
+		template<class P> struct param<P,int> {
+			static int bind(sqlite3_stmt* st, int idx, int v) {
+				return sqlite3_bind_int(st, idx, v);
+			}
+		};
+
+		template<class P> struct param<P,int64_t> {
+			static int bind(sqlite3_stmt* st, int idx, int64_t v) {
+				return sqlite3_bind_int64(st, idx, v);
+			}
+		};
+
+		template<class P> struct param<P,double> {
+			static int bind(sqlite3_stmt* st, int idx, double v) {
+				return sqlite3_bind_double(st, idx, v);
+			}
+		};
+
+		template<class P> struct param<P,const char*> {
+			static int bind(sqlite3_stmt* st, int idx, const char* v) {
+				return sqlite3_bind_text(st, idx, v, -1, SQLITE_TRANSIENT);
+			}
+		};
+
+		template<class P> struct param<P,std::string> {
+			static int bind(sqlite3_stmt* st, int idx, const std::string& v) {
+				return sqlite3_bind_text(st, idx, v.data(), (int)v.size(), SQLITE_TRANSIENT);
+			}
+		};
+
+		template<class P> struct param<P,string_view> {
+			static int bind(sqlite3_stmt* st, int idx, const string_view& v) {
+				return sqlite3_bind_text(st, idx, v.data(), (int)v.size(), SQLITE_TRANSIENT);
+			}
+		};
+
+		template<class P> struct param<P,blob_view> {
+			static int bind(sqlite3_stmt* st, int idx, const blob_view& v) {
+				return sqlite3_bind_blob(st, idx, v.data(), (int)v.size(), SQLITE_TRANSIENT);
+			}
+		};
+
+		template<class P> struct param<P,date_t> {
+			static int bind(sqlite3_stmt* st, int idx, const date_t& v) {
+				// stored as text, matching date_column_type()
+				char buf[16];
+				int n = snprintf(buf, sizeof(buf), "%04d-%02d-%02d", v.year(), v.month(), v.day());
+				return sqlite3_bind_text(st, idx, buf, n, SQLITE_TRANSIENT);
+			}
+		};
+
+		template<class P> struct param<P,std::nullptr_t> {
+			static int bind(sqlite3_stmt* st, int idx, std::nullptr_t) {
+				return sqlite3_bind_null(st, idx);
 			}
 		};
 
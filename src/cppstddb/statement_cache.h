@@ -0,0 +1,106 @@
+#ifndef CPPSTDDB_STATEMENT_CACHE_H
+#define CPPSTDDB_STATEMENT_CACHE_H
+
+#include <cppstddb/log.h>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <functional>
+
+/*
+   LRU cache of prepared driver statement handles, keyed by sql text.
+   Owned by a driver connection (so not thread safe). A statement takes a
+   handle out of the cache when it is prepared and puts it back (reset)
+   when it is destroyed; evicted handles are closed with the supplied closer.
+ */
+
+namespace cppstddb {
+
+    template<class H> class statement_cache {
+        public:
+            using handle_type = H;
+            using string = std::string;
+            using closer_type = std::function<void(handle_type)>;
+
+            static const size_t default_capacity = 64;
+
+            statement_cache(closer_type closer, size_t capacity = default_capacity):
+                closer_(std::move(closer)),
+                capacity_(capacity),
+                hits_(0),
+                misses_(0),
+                evictions_(0) {}
+
+            ~statement_cache() {clear();}
+
+            statement_cache(const statement_cache&) = delete;
+            statement_cache& operator=(const statement_cache&) = delete;
+
+            size_t size() const {return lru_.size();}
+            size_t capacity() const {return capacity_;}
+            size_t hits() const {return hits_;}
+            size_t misses() const {return misses_;}
+            size_t evictions() const {return evictions_;}
+
+            void capacity(size_t n) {
+                capacity_ = n;
+                while (lru_.size() > capacity_) evict();
+            }
+
+            // remove and return the handle for sql, if cached
+            bool take(const string& sql, handle_type& handle) {
+                auto i = index_.find(sql);
+                if (i == index_.end()) {
+                    ++misses_;
+                    return false;
+                }
+                ++hits_;
+                handle = i->second->second;
+                lru_.erase(i->second);
+                index_.erase(i);
+                return true;
+            }
+
+            // return a (reset) handle to the cache as most recently used
+            void put(const string& sql, handle_type handle) {
+                if (!capacity_ || index_.count(sql)) {
+                    // disabled or a duplicate from a concurrently open statement
+                    closer_(handle);
+                    return;
+                }
+                lru_.emplace_front(sql, handle);
+                index_.emplace(sql, lru_.begin());
+                while (lru_.size() > capacity_) evict();
+            }
+
+            void clear() {
+                for(auto& e : lru_) closer_(e.second);
+                lru_.clear();
+                index_.clear();
+            }
+
+        private:
+            using entry = std::pair<string, handle_type>;
+            using list_type = std::list<entry>;
+
+            closer_type closer_;
+            size_t capacity_;
+            size_t hits_;
+            size_t misses_;
+            size_t evictions_;
+            list_type lru_;
+            std::unordered_map<string, typename list_type::iterator> index_;
+
+            void evict() {
+                auto& e = lru_.back();
+                DB_TRACE("statement cache evict: " << e.first);
+                index_.erase(e.first);
+                closer_(e.second);
+                lru_.pop_back();
+                ++evictions_;
+            }
+    };
+
+}
+
+#endif
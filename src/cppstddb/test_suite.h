@@ -6,6 +6,8 @@
 #include <stdexcept>
 #include <numeric>
 #include <algorithm>
+#include <thread>
+#include <atomic>
 
 /*
    A really basic test framework & content to start with,
@@ -57,7 +59,6 @@ namespace cppstddb {
         auto con = db.connection();
         auto stmt = con.statement("select * from score");
         stmt.query();
-        stmt.query(1,2);
         auto rowset = stmt.rows();
         for(auto i = rowset.begin(); i != rowset.end(); ++i) {
             auto row = *i;
@@ -149,6 +150,778 @@ namespace cppstddb {
         assertion(sum == 194);
     }
 
+    template<class database> void block_fetch_test(const std::string& uri) {
+        test_header("block_fetch_test");
+        using namespace std;
+
+        auto db = database(uri);
+        for(int n : {1, 2, 3, 64}) {
+            auto r = db.statement("select name,score from score").query().rows(n);
+            int count = 0, sum = 0;
+            for(auto i = r.begin(); i != r.end(); ++i) {
+                auto row = *i;
+                cout << n << ": " << row[0] << ":" << row[1] << "\n";
+                sum += row[1].template as<int>();
+                ++count;
+            }
+            assertion(count == 3 && sum == 194, "block_fetch_test: wrong rows");
+        }
+
+        auto empty = db.statement("select name from score where score > 1000").query().rows(8);
+        assertion(empty.empty() && empty.begin() == empty.end(), "block_fetch_test: expected no rows");
+    }
+
+    template<class database> void string_view_test(const std::string& uri) {
+        test_header("string_view_test");
+        auto db = database(uri);
+        auto r = db.statement("select name from score").query().rows(2);
+        std::string names;
+        for(auto row : r) {
+            auto v = row[0].template as<string_view>();
+            assertion(v == row[0].str(), "string_view_test: view differs from string");
+            names.append(v.data(), v.size());
+        }
+        assertion(names == "KnuthHopperDijkstra", "string_view_test: wrong names");
+    }
+
+    template<class database> void column_batch_test(const std::string& uri) {
+        test_header("column_batch_test");
+        auto db = database(uri);
+        auto r = db.statement("select name,score,d from score").query().rows();
+
+        auto batch = r.fetch_batch(2);
+        assertion(batch.width() == 3 && batch.length() == 2, "column_batch_test: wrong shape");
+        auto score = batch[1].type();
+        assertion(score == column_type::int32 || score == column_type::int64 || score == column_type::utf8);
+
+        ArrowArray array;
+        ArrowSchema schema;
+        batch.export_to(&array, &schema);
+        assertion(array.n_children == 3 && array.length == 2);
+        assertion(std::string(schema.children[0]->format) == "u");
+        auto names = array.children[0];
+        auto offsets = static_cast<const int32_t*>(names->buffers[1]);
+        auto chars = static_cast<const char*>(names->buffers[2]);
+        assertion(std::string(chars + offsets[1], offsets[2] - offsets[1]) == "Hopper", "column_batch_test: wrong name");
+        array.release(&array);
+        schema.release(&schema);
+
+        auto rest = r.fetch_batch(100);
+        assertion(rest.length() == 1 && r.empty(), "column_batch_test: wrong remainder");
+    }
+
+    template<class database> void typed_rows_test(const std::string& uri) {
+        test_header("typed_rows_test");
+        auto db = database(uri);
+        auto stmt = db.statement("select name,score from score");
+        int count = 0, sum = 0;
+        for(auto t : stmt.query().template rows<std::string,int>(2)) {
+            std::cout << std::get<0>(t) << ":" << std::get<1>(t) << "\n";
+            sum += std::get<1>(t);
+            ++count;
+        }
+        assertion(count == 3 && sum == 194, "typed_rows_test: wrong rows");
+
+        bool mismatch = false;
+        try {
+            db.statement("select score from score").query().template rows<std::string,int>();
+        } catch (const database_error&) {
+            mismatch = true;
+        }
+        assertion(mismatch, "typed_rows_test: column count mismatch not detected");
+    }
+
+    template<class database> void column_name_test(const std::string& uri) {
+        test_header("column_name_test");
+        auto db = database(uri);
+        auto r = db.statement("select name,score from score").query().rows();
+        auto score = r.column("score");
+        assertion(score.index() == 1, "column_name_test: wrong index");
+        int sum = 0;
+        for(auto row : r) {
+            assertion(row["Name"].str() == row[0].str(), "column_name_test: wrong field");
+            sum += row[score].template as<int>();
+        }
+        assertion(sum == 194, "column_name_test: wrong sum");
+
+        bool unknown = false;
+        try {
+            db.statement("select name from score").query().rows().column("missing");
+        } catch (const database_error&) {
+            unknown = true;
+        }
+        assertion(unknown, "column_name_test: unknown column not detected");
+    }
+
+    template<class database> void row_view_test(const std::string& uri) {
+        test_header("row_view_test");
+        auto db = database(uri);
+        auto r = db.statement("select name,score from score").query().rows();
+        auto refs = r.data_.use_count();
+        int sum = 0;
+        for(auto row : r) {
+            assertion(r.data_.use_count() == refs, "row_view_test: row copied the rowset");
+            sum += row[1].template as<int>();
+        }
+        assertion(sum == 194, "row_view_test: wrong sum");
+    }
+
+    template<class database> void async_query_test(const std::string& uri) {
+        test_header("async_query_test");
+        auto db = database(uri);
+
+        // several queries in flight, each on its own pooled connection
+        using statement_t = decltype(db.statement(""));
+        std::vector<async_result<statement_t>> pending;
+        for(int i = 0; i != 8; ++i) {
+            pending.push_back(db.statement("select name,score from score").async_query());
+        }
+        for(auto& p : pending) {
+            int sum = 0;
+            for(auto row : p.get().rows()) sum += row[1].template as<int>();
+            assertion(sum == 194, "async_query_test: wrong sum");
+        }
+
+        auto stmt = db.statement("select score from score where name = " + db.placeholder(1));
+        auto future = stmt.async_query("Hopper").get_future();
+        auto executed = future.get();
+        auto r = executed.rows();
+        assertion(r.front()[0].template as<int>() == 48, "async_query_test: wrong score");
+
+        bool failed = false;
+        try {
+            db.statement("select * from no_such_table").async_query().get();
+        } catch (const database_error&) {
+            failed = true;
+        }
+        assertion(failed, "async_query_test: error not propagated");
+    }
+
+    template<class database> void pipeline_test(const std::string& uri) {
+        test_header("pipeline_test");
+        auto db = database(uri);
+        auto con = db.connection();
+        con.query("delete from score where score < 10");
+        std::string insert = "insert into score values("
+            + db.placeholder(1) + "," + db.placeholder(2) + "," + db.placeholder(3) + ")";
+        {
+            auto p = con.pipeline();
+            for(int i = 0; i != 5; ++i) con.statement(insert).query("Turing", i, date_t(2016,1,1));
+            auto stmt = con.statement("select name,score from score where score < " + db.placeholder(1));
+            stmt.query(10);
+            auto rows = stmt.rows(); // resolves the queued results
+            auto count = std::distance(rows.begin(), rows.end());
+            assertion(count == 5, "pipeline_test: wrong count");
+        }
+        con.query("delete from score where score < 10");
+
+        bool failed = false;
+        try {
+            auto p = con.pipeline();
+            con.statement("insert into no_such_table values(1)").query();
+            p.close();
+        } catch (const database_error&) {
+            failed = true;
+        }
+        assertion(failed, "pipeline_test: error not reported");
+    }
+
+    template<class database> void streaming_test(const std::string& uri) {
+        test_header("streaming_test");
+        auto db = database(uri);
+        auto con = db.connection();
+        for(int n : {1, 2}) {
+            auto stmt = con.statement("select name,score from score");
+            int count = 0, sum = 0;
+            for(auto row : stmt.mode(fetch_mode::streaming).query().rows(n)) {
+                sum += row[1].template as<int>();
+                ++count;
+            }
+            assertion(count == 3 && sum == 194, "streaming_test: wrong rows");
+        }
+
+        // abandon a stream after the first row, then reuse the connection
+        {
+            auto stmt = con.statement("select name from score");
+            auto r = stmt.mode(fetch_mode::streaming).query().rows();
+            assertion(!r.empty(), "streaming_test: expected rows");
+        }
+        auto rows = con.query("select name from score").rows();
+        auto count = std::distance(rows.begin(), rows.end());
+        assertion(count == 3, "streaming_test: connection not usable after abandon");
+    }
+
+    template<class database> void copy_in_test(const std::string& uri) {
+        test_header("copy_in_test");
+        auto db = database(uri);
+        auto con = db.connection();
+
+        std::vector<std::tuple<std::string,int,date_t>> rows;
+        for(int i = 0; i != 10000; ++i) rows.emplace_back("copy_" + std::to_string(i), 1000 + i % 7, date_t(2016,1,1 + i % 28));
+        auto n = con.copy_in("score", {"name", "score", "d"}, rows);
+        assertion(n == rows.size(), "copy_in_test: wrong row count");
+
+        int count = 0;
+        for(auto row : con.query("select name,score,d from score where score >= 1000 order by name").rows(64)) {
+            if (!count) assertion(row[0].str() == "copy_0" && row[2].template as<date_t>().day() == 1);
+            ++count;
+        }
+        assertion(count == 10000, "copy_in_test: rows not loaded");
+        con.query("delete from score where score >= 1000");
+
+        std::vector<std::tuple<std::string,std::nullptr_t,date_t>> nulls = {std::make_tuple("nobody", nullptr, date_t(2016,1,1))};
+        assertion(con.copy_in("score", {"name", "score", "d"}, nulls) == 1, "copy_in_test: null not loaded");
+        con.query("delete from score where name = 'nobody'");
+    }
+
+    template<class database> void copy_out_test(const std::string& uri) {
+        test_header("copy_out_test");
+        auto db = database(uri);
+        auto con = db.connection();
+        int batches = 0, count = 0, sum = 0;
+        con.template copy_out<std::string,int,date_t>(
+                "select name,score,d from score order by score",
+                2,
+                [&](column_batch& batch) {
+                    ++batches;
+                    for(int64_t i = 0; i != batch.length(); ++i) {
+                        sum += batch[1].values()[i];
+                        ++count;
+                    }
+                    if (batches == 1) {
+                        assertion(batch[1].name() == "score", "copy_out_test: wrong column name");
+                        auto& offsets = batch[0].offsets();
+                        auto name = std::string(&batch[0].data()[offsets[0]], offsets[1] - offsets[0]);
+                        assertion(name == "Hopper", "copy_out_test: wrong name");
+                    }
+                });
+        assertion(batches == 2 && count == 3 && sum == 194, "copy_out_test: wrong rows");
+    }
+
+    template<class database> void insert_many_test(const std::string& uri) {
+        test_header("insert_many_test");
+        auto db = database(uri);
+        auto con = db.connection();
+
+        // not a multiple of the rows per statement, so the tail path runs too
+        std::vector<std::tuple<std::string,int,date_t>> rows;
+        for(int i = 0; i != 5003; ++i) rows.emplace_back("bulk_" + std::to_string(i), 1000 + i % 7, date_t(2016,1,1));
+        auto n = con.insert_many("score", {"name", "score", "d"}, rows, 1000);
+        assertion(n == rows.size(), "insert_many_test: wrong row count");
+
+        auto inserted = con.query("select name from score where score >= 1000").rows(64);
+        auto count = std::distance(inserted.begin(), inserted.end());
+        assertion(count == 5003, "insert_many_test: rows not inserted");
+
+        bool failed = false;
+        try {
+            con.insert_many("no_such_table", {"name", "score", "d"}, rows);
+        } catch (const database_error&) {
+            failed = true;
+        }
+        assertion(failed, "insert_many_test: error not reported");
+        con.query("delete from score where score >= 1000");
+    }
+
+    template<class database> void fetch_mode_test(const std::string& uri) {
+        test_header("fetch_mode_test");
+        auto db = database(uri);
+        for(auto mode : {fetch_mode::buffered, fetch_mode::cursor}) {
+            auto stmt = db.statement("select name,score from score");
+            int count = 0, sum = 0;
+            for(auto row : stmt.mode(mode).prefetch(2).query().rows(2)) {
+                sum += row[1].template as<int>();
+                ++count;
+            }
+            assertion(count == 3 && sum == 194, "fetch_mode_test: wrong rows");
+        }
+    }
+
+    template<class database> void seek_test(const std::string& uri) {
+        test_header("seek_test");
+        auto db = database(uri);
+        auto stmt = db.statement("select name,score from score order by score");
+        auto r = stmt.mode(fetch_mode::buffered).query().rows();
+        assertion(r.front()[0].str() == "Hopper", "seek_test: wrong first row");
+        r.seek(2);
+        assertion(r.front()[0].str() == "Dijkstra", "seek_test: wrong row after seek");
+        r.seek(0);
+        assertion(r.front()[0].str() == "Hopper", "seek_test: wrong row after seek back");
+    }
+
+    template<class database> void result_arena_test(const std::string& uri) {
+        test_header("result_arena_test");
+        auto db = database(uri);
+        auto stmt = db.statement("select name,score from score where score > " + db.placeholder(1));
+        const void* arena = nullptr;
+        for(int i = 0; i != 3; ++i) {
+            auto rows = stmt.query(50).rows();
+            auto count = std::distance(rows.begin(), rows.end());
+            assertion(count == 2, "result_arena_test: wrong rows");
+            if (i) assertion(stmt.data_->arena.get() == arena, "result_arena_test: buffers rebuilt");
+            arena = stmt.data_->arena.get();
+        }
+    }
+
+    template<class database> void metadata_cache_test(const std::string& uri) {
+        test_header("metadata_cache_test");
+        auto db = database(uri);
+        auto metadata = [&db](bool again) {
+            auto stmt = db.statement("select name,score from score");
+            auto m = stmt.query().rows().data_->metadata;
+            if (again) assertion(stmt.query().rows().data_->metadata == m, "metadata_cache_test: metadata not reused");
+            return m;
+        };
+        auto m = metadata(true);
+        {
+            // shared by every connection to the database
+            auto con = db.create_connection();
+            auto shared = con.statement("select name,score from score").query().rows().data_->metadata;
+            assertion(shared == m, "metadata_cache_test: metadata not shared");
+        }
+
+        auto epoch = schema_epoch();
+        drop_table(db, "metadata_cache");
+        db.query("create table metadata_cache (a integer)");
+        assertion(schema_epoch() > epoch, "metadata_cache_test: ddl did not bump epoch");
+        assertion(metadata(false) != m, "metadata_cache_test: stale metadata");
+
+        // ddl run by the driver directly, not through a statement
+        epoch = schema_epoch();
+        db.connection().data_->exec("drop table metadata_cache");
+        assertion(schema_epoch() > epoch, "metadata_cache_test: exec did not bump epoch");
+    }
+
+    template<class database> void connection_pool_test(const std::string& uri) {
+        test_header("connection_pool_test");
+        auto db = database(uri);
+        db.query("select * from score");
+        db.query("select * from score");
+        assertion(db.pool().size() == 1, "pooled connection not reused");
+        {
+            auto a = db.connection(), b = db.connection();
+            assertion(db.pool().size() == 2, "concurrent leases share a connection");
+        }
+        assertion(db.pool().idle() == 2, "leases not returned to pool");
+        auto c = db.create_connection();
+        assertion(db.pool().size() == 2, "create_connection used the pool");
+
+        // a lease goes back without its open transaction
+        {
+            auto d = db.connection();
+            d.begin();
+            d.query("insert into score values('Turing',41,'2016-04-04')");
+        }
+        auto rows = db.query("select name from score where name = 'Turing'").rows();
+        assertion(rows.begin() == rows.end(), "transaction survived release");
+
+        pool_options options;
+        options.min_size = 2;
+        auto warm = database(uri, options);
+        assertion(warm.pool().size() == 2 && warm.pool().idle() == 2, "min_size connections not opened");
+    }
+
+    template<class database> void native_types_test(const std::string& uri) {
+        test_header("native_types_test");
+        auto db = database(uri);
+        drop_table(db, "native");
+        db.query("create table native (i integer, r real, b blob)");
+        const unsigned char bytes[] = {0, 1, 0xfe, 0xff};
+        auto insert = db.statement("insert into native values(" +
+                db.placeholder(1) + "," + db.placeholder(2) + "," + db.placeholder(3) + ")");
+        insert.query(int64_t(1) << 40, 2.5, blob_view(bytes, sizeof(bytes)));
+
+        for(int block : {1, 2}) {
+            auto stmt = db.statement("select i, r, b, i + 1 from native");
+            auto r = stmt.query().rows(block);
+            auto row = r.front();
+            assertion(row[0].type() == value_int64 && row[1].type() == value_double, "native_types_test: wrong types");
+            assertion(row[2].type() == value_blob && row[3].type() == value_int64, "native_types_test: wrong types");
+            assertion(row[0].template as<int64_t>() == int64_t(1) << 40, "native_types_test: wrong int64");
+            assertion(row[1].template as<double>() == 2.5, "native_types_test: wrong double");
+            auto b = row[2].template as<blob_view>();
+            assertion(b.size() == sizeof(bytes) && std::equal(b.begin(), b.end(), bytes), "native_types_test: wrong blob");
+            std::stringstream ss;
+            ss << row[0] << "," << row[1] << "," << row[2];
+            assertion(ss.str() == "1099511627776,2.5,0001feff", "native_types_test: wrong text");
+            auto i = row[0].template as<string_view>(), d = row[1].template as<string_view>();
+            assertion(i == "1099511627776" && d == "2.5", "native_types_test: text views alias");
+        }
+
+        // the storage class wins over the declared type
+        db.query("insert into native values('n/a', 0, null)");
+        for(int block : {1, 2}) {
+            auto r = db.statement("select i from native where r = 0").query().rows(block);
+            auto row = r.front();
+            std::stringstream ss;
+            ss << row[0];
+            assertion(row[0].type() == value_string && ss.str() == "n/a", "native_types_test: text in integer column");
+        }
+
+        // nulls print empty; reals read as text the same way in both modes
+        db.query("insert into native values(null, 1.0, null)");
+        for(int block : {1, 2}) {
+            auto r = db.statement("select i, r from native where i is null").query().rows(block);
+            auto row = r.front();
+            std::stringstream ss;
+            ss << row[0];
+            assertion(row[0].is_null() && ss.str().empty(), "native_types_test: null printed");
+            assertion(row[1].template as<string_view>() == "1.0", "native_types_test: real text");
+        }
+
+        auto batch = db.statement("select i, r, b from native").query().rows().fetch_batch(10);
+        assertion(batch[0].type() == column_type::int64 && batch[0].values64()[0] == int64_t(1) << 40);
+        assertion(batch[1].type() == column_type::float64 && batch[1].reals()[0] == 2.5);
+        assertion(batch[2].type() == column_type::binary && batch[2].data().size() == sizeof(bytes));
+        drop_table(db, "native");
+    }
+
+    template<class database> void read_scaling_test(const std::string& uri) {
+        test_header("read_scaling_test");
+        pool_options options;
+        options.readers = 4;
+        auto db = database(uri, options);
+
+        // the one writer: don't ask the database for another while holding it
+        auto writer = db.connection();
+        writer.query("create table if not exists scaling (name varchar(10))");
+        writer.query("delete from scaling");
+        for(auto name : {"Knuth", "Hopper", "Dijkstra"}) {
+            writer.query(std::string("insert into scaling values('") + name + "')");
+        }
+
+        // readers are not blocked by, and do not see, an open write transaction
+        writer.begin();
+        writer.query("insert into scaling values('Turing')");
+        auto count = [&db] {
+            auto rows = db.query("select name from scaling").rows();
+            return std::distance(rows.begin(), rows.end());
+        };
+        assertion(count() == 3, "read_scaling_test: reader saw uncommitted row");
+        writer.commit();
+
+        std::atomic<int> good(0);
+        std::vector<std::thread> threads;
+        for(int i = 0; i != 4; ++i) {
+            threads.emplace_back([&] {
+                try {
+                    for(int n = 0; n != 10; ++n) if (count() != 4) return;
+                    ++good;
+                } catch (const std::exception& e) {
+                    std::cout << "read_scaling_test: " << e.what() << "\n";
+                }
+            });
+        }
+        for(auto& t : threads) t.join();
+        assertion(good == 4, "read_scaling_test: concurrent reads failed");
+        assertion(db.pool().size() == 1, "read_scaling_test: more than one writer");
+
+        bool refused = false;
+        try {
+            db.read_connection().query("delete from scaling");
+        } catch (const database_error&) {
+            refused = true;
+        }
+        assertion(refused, "read_scaling_test: read only connection wrote");
+
+        // a second writer lease on this thread fails at once
+        refused = false;
+        try {
+            db.query("delete from scaling");
+        } catch (const database_error&) {
+            refused = true;
+        }
+        assertion(refused, "read_scaling_test: writer leased twice");
+
+        // with ... insert changes data: it goes to the writer
+        assertion(is_query("with n as (select 1) select * from n"), "read_scaling_test: with select not routed to readers");
+        assertion(!is_query("with n(name) as (select 'Lovelace') insert into scaling select name from n"),
+                "read_scaling_test: with insert routed to readers");
+        assertion(is_query("with n as (select 'insert') select * from n -- delete"), "read_scaling_test: keyword in a literal");
+    }
+
+    template<class database> void parallel_query_test(const std::string& uri) {
+        test_header("parallel_query_test");
+        pool_options options;
+        options.readers = 4;
+        auto db = database(uri, options);
+        {
+            auto writer = db.connection();
+            writer.query("create table if not exists scan (k integer primary key, v integer)");
+            writer.query("delete from scan");
+            std::vector<std::tuple<int64_t,int64_t>> rows;
+            for(int64_t i = 1; i <= 10000; ++i) rows.emplace_back(i, i % 10);
+            writer.insert_many("scan", {"k", "v"}, rows);
+        }
+        const std::string bounds = "select min(k), max(k) from scan";
+
+        int64_t count = 0, sum = 0, last = 0;
+        bool in_order = true;
+        auto rows = db.template parallel_query<int64_t,int64_t>("select k, v from scan where k >= ? and k <= ?", 4, bounds, true);
+        for(auto& t : rows) {
+            in_order = in_order && std::get<0>(t) > last;
+            last = std::get<0>(t);
+            sum += std::get<1>(t);
+            ++count;
+        }
+        assertion(count == 10000 && sum == 45000, "parallel_query_test: wrong rows");
+        assertion(in_order, "parallel_query_test: ordered scan out of order");
+
+        // aggregate per slice, combine here
+        count = sum = 0;
+        int slices = 0;
+        for(auto& t : db.template parallel_query<int64_t,int64_t>("select count(*), sum(v) from scan where k >= ? and k <= ?", 4, bounds)) {
+            count += std::get<0>(t);
+            sum += std::get<1>(t);
+            ++slices;
+        }
+        assertion(slices == 4 && count == 10000 && sum == 45000, "parallel_query_test: wrong aggregate");
+
+        // more slices than readers, in order: workers take the slices in key order
+        count = last = 0;
+        in_order = true;
+        for(auto& t : db.template parallel_query<int64_t,int64_t>("select k, v from scan where k >= ? and k <= ?", 16, bounds, true)) {
+            in_order = in_order && std::get<0>(t) > last;
+            last = std::get<0>(t);
+            ++count;
+        }
+        assertion(count == 10000 && in_order, "parallel_query_test: more slices than readers");
+
+        // a worker that gets no connection leaves its slices to the others
+        {
+            pool_options busy;
+            busy.readers = 2;
+            busy.acquire_timeout = std::chrono::milliseconds(200);
+            auto busy_db = database(uri, busy);
+            auto held = busy_db.read_connection();
+            auto scan = busy_db.template parallel_query<int64_t,int64_t>("select k, v from scan where k >= ? and k <= ?", 4, bounds, true);
+            std::this_thread::sleep_for(std::chrono::milliseconds(400)); // past the other worker's timeout
+            count = std::distance(scan.begin(), scan.end());
+            assertion(count == 10000, "parallel_query_test: slices lost with a worker short of a connection");
+        }
+
+        // slices cover the key range exactly, up to the largest key
+        auto top = key_slices(INT64_MAX - 9, INT64_MAX, 4);
+        assertion(top.size() == 4 && top.front().first == INT64_MAX - 9 && top.back().second == INT64_MAX,
+                "parallel_query_test: slices at INT64_MAX");
+        auto all = key_slices(INT64_MIN, INT64_MAX, 3);
+        assertion(all.size() == 3 && all.front().first == INT64_MIN && all.back().second == INT64_MAX
+                && all[1].first == all[0].second + 1 && all[2].first == all[1].second + 1,
+                "parallel_query_test: slices of the whole range");
+        assertion(key_slices(5, 6, 8).size() == 2, "parallel_query_test: more slices than keys");
+
+        // abandoned early: workers are stopped
+        auto partial = db.template parallel_query<int64_t,int64_t>("select k, v from scan where k >= ? and k <= ?", 4, bounds);
+        assertion(!partial.empty());
+    }
+
+    inline void async_log_test() {
+        test_header("async_log_test");
+        auto& l = log();
+        auto level = l.level();
+        auto out = std::tmpfile();
+        l.level("INFO");
+        l.async(log_overflow::block, out);
+
+        std::vector<std::thread> threads;
+        for(int t = 0; t != 4; ++t) {
+            threads.emplace_back([t] {
+                for(int i = 0; i != 1000; ++i) DB_INFO("async_log_test: thread " << t << ", message " << i);
+            });
+        }
+        for(auto& t : threads) t.join();
+        l.sync();
+        l.level(log_level_info::get(level).name);
+
+        std::rewind(out);
+        int lines = 0;
+        for(int c; (c = std::fgetc(out)) != EOF;) if (c == '\n') ++lines;
+        std::fclose(out);
+        assertion(lines == 4000, "async_log_test: messages lost");
+    }
+
+    // category: the driver's (database's namespace)
+    template<class database> void log_category_test(const std::string& uri, log_category category) {
+        test_header("log_category_test");
+        auto& l = log();
+        auto db = database(uri);
+        auto out = std::tmpfile();
+        auto lines = [out] {
+            std::rewind(out);
+            int n = 0;
+            for(int c; (c = std::fgetc(out)) != EOF;) if (c == '\n') ++n;
+            return n;
+        };
+        auto level = log_level_info::get(l.level(category)).name;
+
+        l.async(log_overflow::block, out);
+        l.level(category, "TRACE");
+        assertion(l.is_level_enabled(category, log_level::trace));
+        assertion(!l.is_level_enabled(log_category::front, log_level::trace), "log_category_test: level leaked");
+        db.query("select name from score").rows().write(std::cout);
+        l.sync();
+        auto traced = lines();
+
+        l.level(category, level);
+        l.async(log_overflow::block, out);
+        db.query("select name from score").rows().write(std::cout);
+        l.sync();
+        auto after = lines();
+        std::fclose(out);
+        assertion(traced > 1, "log_category_test: no driver trace");
+        assertion(after == traced, "log_category_test: trace after reset");
+    }
+
+    inline void uri_test() {
+        test_header("uri_test");
+        auto s = uri_to_source(test_uri("mysql", "DB-Host.example.com"));
+        assertion(s.protocol == "mysql" && s.server == "DB-Host.example.com" && s.port == 0, "uri_test: host");
+        assertion(s.database == "cppstddb" && s.username == "test" && s.password == "test", "uri_test: credentials");
+
+        s = uri_to_source("postgres://u%40x:p%3Aw@[::1]:6432/db?sslmode=require&application_name=a%20b");
+        assertion(s.server == "::1" && s.port == 6432 && s.database == "db", "uri_test: ipv6");
+        assertion(s.username == "u@x" && s.password == "p:w", "uri_test: userinfo");
+        assertion(s.option("sslmode", "") == "require" && *s.option("application_name") == "a b", "uri_test: options");
+        assertion(!s.option("missing"), "uri_test: missing option");
+
+        s = uri_to_source("postgres://%2Fvar%2Frun%2Fpostgresql/db");
+        assertion(s.is_unix_socket() && s.server == "/var/run/postgresql" && s.port == 0, "uri_test: socket");
+
+        s = uri_to_source("file:///tmp/x.sqlite?journal_mode=wal");
+        assertion(s.server == "/tmp/x.sqlite" && s.option("journal_mode", "") == "wal" && s.port == 0, "uri_test: file");
+
+        for(auto bad : {"no-scheme", "mysql://host:99999/db", "mysql://[::1/db", "mysql://host:/db"}) {
+            bool failed = false;
+            try {
+                uri_to_source(bad);
+            } catch (const database_error&) {
+                failed = true;
+            }
+            assertion(failed, "uri_test: bad uri accepted");
+        }
+    }
+
+    // sqlite: pragmas and open flags from uri options
+    template<class database> void sqlite_options_test(const std::string& path) {
+        test_header("sqlite_options_test");
+        auto db = database("file://" + path + "?profile=read_mostly&cache_size=-1000&busy_timeout=250");
+        auto con = db.connection();
+        auto pragma = [&con](const std::string& name) {
+            for(auto t : con.query("pragma " + name).template rows<std::string>()) return std::get<0>(t);
+            return std::string();
+        };
+        assertion(pragma("journal_mode") == "wal", "sqlite_options_test: journal_mode");
+        assertion(pragma("synchronous") == "1", "sqlite_options_test: profile synchronous");
+        assertion(pragma("cache_size") == "-1000", "sqlite_options_test: option over profile");
+        assertion(pragma("temp_store") == "2", "sqlite_options_test: temp_store");
+
+        for(auto bad : {"?synchronous=off;vacuum", "?profile=unknown", "?mutex=maybe", "?busy_timeout=abc"}) {
+            bool failed = false;
+            try {
+                database("file://" + path + bad).connection();
+            } catch (const database_error&) {
+                failed = true;
+            }
+            assertion(failed, "sqlite_options_test: bad option accepted");
+        }
+
+        // another uri for a connection is parsed once per database
+        auto other = "file://" + path + "?cache_size=-500";
+        db.connection(other);
+        db.connection(other);
+        assertion(db.data_->sources.size() == 1, "sqlite_options_test: connection uri parsed again");
+
+        // a preset for loading still leaves room for read only connections
+        pool_options options;
+        options.readers = 2;
+        auto loading = database("file://" + path + "?profile=bulk_load", options);
+        auto writer = loading.connection();
+        auto reader = loading.read_connection();
+        bool conflict = false;
+        try {
+            database("file://" + path + "?journal_mode=delete", options).connection();
+        } catch (const database_error&) {
+            conflict = true;
+        }
+        assertion(conflict, "sqlite_options_test: journal_mode other than wal with readers");
+
+        auto frozen = database("file://" + path + "?immutable=1").connection();
+        bool refused = false;
+        try {
+            frozen.query("create table frozen(a integer)");
+        } catch (const database_error&) {
+            refused = true;
+        }
+        assertion(refused, "sqlite_options_test: immutable database written");
+    }
+
+    template<class database> void statement_cache_test(const std::string& uri) {
+        test_header("statement_cache_test");
+        auto db = database(uri);
+        auto con = db.create_connection();
+        auto& cache = con.data_->statements;
+        auto hits = cache.hits(), misses = cache.misses();
+        con.query("select * from score").rows().write(std::cout);
+        con.query("select * from score").rows().write(std::cout);
+        assertion(cache.misses() == misses + 1, "statement cache: expected one miss");
+        assertion(cache.hits() == hits + 1, "statement cache: expected one hit");
+        assertion(cache.size() == 1);
+
+        cache.capacity(1);
+        con.query("select name from score");
+        assertion(cache.evictions() == 1, "statement cache: expected eviction");
+    }
+
+    template<class database> void bind_test(const std::string& uri) {
+        test_header("bind_test");
+        auto db = database(uri);
+        auto con = db.connection();
+
+        std::stringstream insert;
+        insert
+            << "insert into score values("
+            << db.placeholder(1) << ","
+            << db.placeholder(2) << ","
+            << db.placeholder(3) << ")";
+
+        auto stmt = con.statement(insert.str());
+        stmt.query("Lovelace", 99, date_t(2016,4,4));
+        stmt.query(std::string("Turing"), 77, date_t(2016,5,5));
+
+        auto select = con.statement("select score, d from score where name = " + db.placeholder(1));
+        auto r = select.query("Turing").rows();
+        assertion(!r.empty(), "bind_test: no row");
+        auto d = r.front()[1].template as<date_t>();
+        assertion(r.front()[0].template as<int>() == 77, "bind_test: wrong row");
+        assertion(d.year() == 2016 && d.month() == 5 && d.day() == 5, "bind_test: wrong date");
+
+        auto remove = con.statement("delete from score where name = " + db.placeholder(1));
+        remove.query("Lovelace");
+        remove.query("Turing");
+    }
+
+    // 64 bit integers, doubles and text written as parameters read back
+    template<class database> void wide_types_test(const std::string& uri) {
+        test_header("wide_types_test");
+        auto db = database(uri);
+        auto con = db.connection();
+        drop_table(db, "wide_types");
+        con.query("create table wide_types (a bigint, b double precision, c text)");
+        auto insert = con.statement(
+                "insert into wide_types values(" +
+                db.placeholder(1) + "," + db.placeholder(2) + "," + db.placeholder(3) + ")");
+        insert.query(int64_t(1) << 40, 2.5, std::string("text"));
+
+        int rows = 0;
+        for(auto t : con.query("select a, b, c from wide_types").template rows<int64_t,double,std::string>()) {
+            assertion(std::get<0>(t) == int64_t(1) << 40 && std::get<1>(t) == 2.5 && std::get<2>(t) == "text",
+                    "wide_types_test: wrong values");
+            ++rows;
+        }
+        assertion(rows == 1, "wide_types_test: wrong rows");
+        drop_table(db, "wide_types");
+    }
+
     template<class database> void test_all(const std::string& uri) {
         {
             auto db = database(uri);
@@ -163,6 +936,15 @@ namespace cppstddb {
         iterator_1_test<database>(uri);
         stl_find_if_test<database>(uri);
         stl_accumulate_test<database>(uri);
+        block_fetch_test<database>(uri);
+        string_view_test<database>(uri);
+        column_batch_test<database>(uri);
+        typed_rows_test<database>(uri);
+        column_name_test<database>(uri);
+        row_view_test<database>(uri);
+        streaming_test<database>(uri);
+        fetch_mode_test<database>(uri);
+        connection_pool_test<database>(uri);
     }
 
 
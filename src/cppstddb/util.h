@@ -2,67 +2,67 @@
 #define CPPSTDDB_UTIL_H
 
 #include "source.h"
-#include <regex>
+#include "database_error.h"
+#include <sstream>
+#include <cctype>
+#include <cstring>
 
 namespace cppstddb {
 
-    template<class iterator, class sentinel>
-        bool find_key(iterator& iter, sentinel end, const std::string& key) {
-            // nothing fancy here yet
-            if (iter == end || key.empty()) return false;
-            auto c = key[0];
-            do {
-                auto it = iter;
-                if (*it == c) {
-                    auto i = key.begin(), e = key.end();
-                    while (*it == *i && ++i != e && ++it != end);
-                    if (i == e) return true;
-                }
-            } while (++iter != end);
-            return false;
+    // whether the first word of sql is one of keywords (lower case), without allocating
+    template<size_t N> bool leading_keyword(const std::string& sql, const char* const (&keywords)[N]) {
+        size_t i = 0;
+        while (i != sql.size() && isspace(static_cast<unsigned char>(sql[i]))) ++i;
+        size_t j = i;
+        while (j != sql.size() && isalpha(static_cast<unsigned char>(sql[j]))) ++j;
+        for(auto k : keywords) {
+            if (strlen(k) != j - i) continue;
+            size_t n = 0;
+            while (n != j - i && tolower(static_cast<unsigned char>(sql[i + n])) == k[n]) ++n;
+            if (n == j - i) return true;
         }
+        return false;
+    }
 
-    template<class iterator, class sentinel>
-        bool get_token_and_key(iterator& iter, sentinel end, const std::string& key, std::string& value) {
-            // get token followed by key. if key not found, return false but assign value anyway
-            auto start = iter;
-            if (!find_key(iter, end, key)) {
-                value.assign(start, end);
-                return false;
+    // whether any word of sql is one of keywords (lower case), outside
+    // quotes and comments
+    template<size_t N> bool contains_keyword(const std::string& sql, const char* const (&keywords)[N]) {
+        auto word = [](char c) {return isalnum(static_cast<unsigned char>(c)) || c == '_';};
+        size_t i = 0, n = sql.size();
+        while (i != n) {
+            auto c = sql[i];
+            if (c == '\'' || c == '"' || c == '`') {
+                auto end = sql.find(c, i + 1); // a doubled quote reads as two quoted runs
+                i = end == std::string::npos ? n : end + 1;
+            } else if (c == '-' && i + 1 != n && sql[i + 1] == '-') {
+                auto end = sql.find('\n', i);
+                i = end == std::string::npos ? n : end + 1;
+            } else if (word(c)) {
+                size_t j = i;
+                while (j != n && word(sql[j])) ++j;
+                for(auto k : keywords) {
+                    if (strlen(k) != j - i) continue;
+                    size_t m = 0;
+                    while (m != j - i && tolower(static_cast<unsigned char>(sql[i + m])) == k[m]) ++m;
+                    if (m == j - i) return true;
+                }
+                i = j;
+            } else {
+                ++i;
             }
-            value.assign(start, iter);
-            iter += key.size();
-            return true;
-        }
-
-    template<class iterator, class sentinel, class string>
-        void get_qs_key_value(
-                iterator& i, 
-                sentinel e, 
-                string& key, 
-                string& value) {
-            auto s = i;
-            while (i != e && *i != '=' ) ++i;
-            if (i == e) return;
-            key.assign(s,i);
-            if (++i == e) return;
-            s = i;
-            while (i != e && *i != '&' ) ++i;
-            value.assign(s,i);
-            if (i != e) ++i;
         }
+        return false;
+    }
 
-    inline void key_value_to_source(
-            const std::string& key, 
-            const std::string& value,
-            source& src) {
-
-        // better logic soon
-        if (key == "username") {
-            src.username = value;
-        } else if (key == "password") {
-            src.password = value;
-        }
+    // statements that only read: routed to read only connections (see
+    // pool_options::readers). a with or explain statement qualifies only
+    // without a data changing keyword (with ... insert, explain analyze delete)
+    inline bool is_query(const std::string& sql) {
+        static const char* const reads[] = {"select"};
+        static const char* const maybe[] = {"with", "explain"};
+        static const char* const writes[] = {"insert", "update", "delete", "replace", "merge", "upsert"};
+        if (leading_keyword(sql, reads)) return true;
+        return leading_keyword(sql, maybe) && !contains_keyword(sql, writes);
     }
 
     inline auto get_uri(
@@ -81,38 +81,106 @@ namespace cppstddb {
         return s.str();
     }
 
-    inline source uri_to_source(const std::string& uri) {
-        // example: mysql://127.0.0.1:3306/dbname&username=root&password=123
-        //          oracle://127.0.0.1:1521/orcl&username=scott&password=tiger
-        //          file://testdb.sqlite
-        std::regex pieces_re("([a-z]+)://([a-z0-9_.]+)(:([0-9]+))?(/([a-z0-9_]+)\\?username=([a-z0-9_]+)&password=(.+))?");
-        std::smatch pieces_match;
+    namespace uri_impl {
 
-        std::regex_match(uri, pieces_match, pieces_re);
+        inline const char* find(const char* b, const char* e, char c) {
+            auto p = static_cast<const char*>(memchr(b, c, e - b));
+            return p ? p : e;
+        }
 
-        //if(pieces_match.size() != 8) return source();
+        inline const char* rfind(const char* b, const char* e, char c) {
+            for(auto p = e; p != b;) if (*--p == c) return p;
+            return e;
+        }
 
+        inline int hex(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        // [b,e) with %xx decoded
+        inline void decode(const char* b, const char* e, std::string& out) {
+            out.reserve(out.size() + (e - b));
+            while (b != e) {
+                if (*b == '%' && e - b >= 3 && hex(b[1]) >= 0 && hex(b[2]) >= 0) {
+                    out += static_cast<char>(hex(b[1]) * 16 + hex(b[2]));
+                    b += 3;
+                } else {
+                    out += *b++;
+                }
+            }
+        }
+
+        inline void raise_error(const std::string& msg, const std::string& uri) {
+            throw database_error("uri: " + msg + ": " + uri);
+        }
+
+    }
+
+    // protocol://[username[:password]@]host[:port][/database][?key=value&...]
+    // where host is a name, an [ipv6] address or a percent encoded unix socket
+    // path (%2Ftmp), and file://path[?key=value&...] (sqlite). username and
+    // password may also be query string keys; other keys go to source::options.
+    // one pass over the text: the only allocations are the source's strings.
+    // a database parses its uri once and its connections copy the result
+    inline source uri_to_source(const std::string& uri) {
+        using namespace uri_impl;
         source s;
-        s.protocol = pieces_match[1].str();
-        s.server = pieces_match[2].str();
-        s.port = pieces_match[3].matched ? atoi(pieces_match[4].str().c_str()) : 1521;
-        s.database = pieces_match[6].str();
-        s.username = pieces_match[7].str();
-        s.password = pieces_match[8].str();
-
-        /*auto iter = uri.begin(), end = uri.end();
-        if (! get_token_and_key(iter, end, "://", s.protocol)) return s;
-        if (! get_token_and_key(iter, end, "/", s.server)) return s;
-        if (! get_token_and_key(iter, end, "?", s.database)) return s;
-
-        while (iter != end) {
-            std::string key,value;
-            get_qs_key_value(iter, end, key, value);
-            key_value_to_source(key, value, s);
-        }*/
+        auto scheme = uri.find("://");
+        if (scheme == std::string::npos) uri_impl::raise_error("expected protocol://", uri);
+        s.protocol.assign(uri, 0, scheme);
+
+        auto b = uri.data() + scheme + 3, e = uri.data() + uri.size();
+        auto q = find(b, e, '?');
+        if (s.protocol == "file") {
+            decode(b, q, s.server);
+        } else {
+            auto slash = find(b, q, '/');
+            auto at = rfind(b, slash, '@');
+            if (at != slash) {
+                auto colon = find(b, at, ':');
+                decode(b, colon, s.username);
+                if (colon != at) decode(colon + 1, at, s.password);
+                b = at + 1;
+            }
+            auto host_end = b;
+            if (b != slash && *b == '[') {
+                host_end = find(b, slash, ']');
+                if (host_end == slash) uri_impl::raise_error("unterminated [ipv6] host", uri);
+                s.server.assign(b + 1, host_end++);
+            } else {
+                host_end = find(b, slash, ':');
+                decode(b, host_end, s.server);
+            }
+            if (host_end != slash) {
+                if (*host_end != ':' || host_end + 1 == slash) uri_impl::raise_error("bad port", uri);
+                int port = 0;
+                for(auto p = host_end + 1; p != slash; ++p) {
+                    if (!isdigit(static_cast<unsigned char>(*p)) || (port = port * 10 + (*p - '0')) > 65535) {
+                        uri_impl::raise_error("bad port", uri);
+                    }
+                }
+                s.port = port;
+            }
+            if (slash != q) decode(slash + 1, q, s.database);
+        }
 
+        while (q != e) {
+            b = q + 1;
+            q = find(b, e, '&');
+            auto eq = find(b, q, '=');
+            std::string key, value;
+            decode(b, eq, key);
+            if (eq != q) decode(eq + 1, q, value);
+            if (key == "username") s.username = std::move(value);
+            else if (key == "password") s.password = std::move(value);
+            else if (!key.empty()) s.options.emplace_back(std::move(key), std::move(value));
+        }
         return s;
     }
+
 }
 
 #endif
@@ -7,7 +7,12 @@ using namespace std;
 int main() {
     try {
 		using namespace cppstddb;
-        test_all<mysql::database>(test_uri("mysql"));
+        auto uri = test_uri("mysql");
+        test_all<mysql::database>(uri);
+        statement_cache_test<mysql::database>(uri);
+        bind_test<mysql::database>(uri);
+        seek_test<mysql::database>(uri);
+        result_arena_test<mysql::database>(uri);
     } catch (cppstddb::database_error &e) {
         cppstddb::vertical_print(cout, e);
     } catch (exception &e) {
@@ -7,7 +7,16 @@ using namespace std;
 int main() {
 	try {
 		using namespace cppstddb;
-		test_all<postgres::database>(test_uri("postgres"));
+		auto uri = test_uri("postgres");
+		test_all<postgres::database>(uri);
+		statement_cache_test<postgres::database>(uri);
+		bind_test<postgres::database>(uri);
+		wide_types_test<postgres::database>(uri);
+		metadata_cache_test<postgres::database>(uri);
+		async_query_test<postgres::database>(uri);
+		pipeline_test<postgres::database>(uri);
+		copy_in_test<postgres::database>(uri);
+		copy_out_test<postgres::database>(uri);
 	} catch (exception &e) {
 		cout << "exception: " << e.what() << endl;
 	}
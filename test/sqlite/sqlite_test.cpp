@@ -9,6 +9,18 @@ int main() {
 		using namespace cppstddb;
         string uri = "file://testdb.sqlite";
         test_all<sqlite::database>(uri);
+        statement_cache_test<sqlite::database>(uri);
+        bind_test<sqlite::database>(uri);
+        wide_types_test<sqlite::database>(uri);
+        metadata_cache_test<sqlite::database>(uri);
+        insert_many_test<sqlite::database>(uri);
+        native_types_test<sqlite::database>(uri);
+        read_scaling_test<sqlite::database>("file://testdb_wal.sqlite");
+        parallel_query_test<sqlite::database>("file://testdb_wal.sqlite");
+        async_log_test();
+        log_category_test<sqlite::database>(uri, log_category::sqlite);
+        uri_test();
+        sqlite_options_test<sqlite::database>("testdb_opts.sqlite");
     } catch (cppstddb::database_error &e) {
         cppstddb::vertical_print(cout, e);
     } catch (exception &e) {